@@ -0,0 +1,79 @@
+// Cost of animating the asteroid belt on the CPU, per frame: every asteroid
+// is moved along its Keplerian orbit and its instance matrix written out, the
+// work the scene hands to its background job.
+//
+//   belt_bench [asteroids...]
+//
+// Defaults to 10k, 100k, 1M and 10M asteroids. Prints the time per frame and
+// how many asteroids fit in a 60 FPS frame at that rate, with the bandwidth
+// their upload takes. The upload itself and the draw are not measured, they
+// need a GL context.
+#include "asteroids.h"
+#include "bodies.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const double FRAME_SECONDS = 1.0 / 60.0;
+
+int main(int argc, char *argv[]) {
+  std::vector<unsigned int> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back((unsigned int)strtoul(argv[i], NULL, 10));
+  if (sizes.empty()) {
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+    sizes.push_back(10000000);
+  }
+
+  OrbitalElements planets;
+  addPlanets(planets);
+  double gmSun = sunGM(planets);
+  ThreadPool pool;
+
+  printf("Keplerian belt animation, %s kernel, %u threads\n",
+         KeplerPropagator::kernelName(), pool.size());
+  printf("%10s %10s %14s %14s\n", "asteroids", "ms/frame", "max at 60 FPS",
+         "upload GB/s");
+  for (size_t s = 0; s < sizes.size(); s++) {
+    unsigned int amount = sizes[s];
+    AsteroidField field;
+    generateAsteroidField(field, amount, 0, pool);
+    OrbitalElements orbits;
+    beltElements(orbits, field, gmSun);
+    KeplerPropagator propagator(orbits);
+
+    std::vector<float> base(16 * (size_t)amount, 0.0f), out(base.size());
+    for (size_t i = 0; i < amount; i++)
+      base[16 * i] = base[16 * i + 5] = base[16 * i + 10] = field.scale[i];
+    std::vector<float> x(amount), y(amount), z(amount);
+
+    int frames = 0;
+    double t = 0.0, elapsed = 0.0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    while (elapsed < 2.0 || frames < 3) {
+      pool.parallelFor(amount, [&](size_t begin, size_t end) {
+        propagator.propagateRange(t, begin, end, &x[0], &y[0], &z[0]);
+        placeInstances(&base[0], &x[0], &y[0], &z[0], 149.597870f, begin, end,
+                       &out[0]);
+      });
+      t += 256.0;
+      frames++;
+      elapsed = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    }
+
+    double perFrame = elapsed / frames;
+    double fits = amount * FRAME_SECONDS / perFrame;
+    printf("%10u %10.3f %14.0f %14.2f\n", amount, perFrame * 1000.0, fits,
+           fits * 16 * sizeof(float) / FRAME_SECONDS / 1e9);
+  }
+  return 0;
+}
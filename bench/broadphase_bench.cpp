@@ -0,0 +1,165 @@
+// Cost of finding touching asteroids in a moving belt, per step.
+//
+//   broadphase_bench [bodies...]
+//
+// Defaults to 10k, 100k and 1M bodies. Bodies go round circular orbits at
+// their Keplerian speed, so the belt shears between steps like the scene's,
+// with the scene's 256 tick step and asteroid sizes. Before timing, the
+// contacts of a small belt are checked against testing every pair.
+#include "broadphase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Sun's gravitational parameter in AU^3 / tick^2, the scene's Earth speed
+static const double GM_SUN = 2.7051e-9;
+// radius of the rock model at scale 1, in AU
+static const double ROCK_RADIUS = 2.14 / 149.597870;
+
+struct Belt {
+  std::vector<double> r, phase, n, tilt;
+  std::vector<double> x, y, z;
+  std::vector<float> radius;
+
+  void moveTo(double t) {
+    for (size_t i = 0; i < r.size(); i++) {
+      double angle = phase[i] + n[i] * t;
+      x[i] = r[i] * cos(angle);
+      y[i] = r[i] * sin(angle);
+      z[i] = r[i] * tilt[i] * sin(angle);
+    }
+  }
+};
+
+static void makeBelt(Belt &belt, size_t count) {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<double> radius(2.2, 3.3);
+  std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+  std::uniform_real_distribution<double> tilt(-0.02, 0.02);
+  std::uniform_int_distribution<int> size(0, 19);
+
+  belt.r.resize(count);
+  belt.phase.resize(count);
+  belt.n.resize(count);
+  belt.tilt.resize(count);
+  belt.x.resize(count);
+  belt.y.resize(count);
+  belt.z.resize(count);
+  belt.radius.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    belt.r[i] = radius(rng);
+    belt.phase[i] = angle(rng);
+    belt.n[i] = sqrt(GM_SUN / (belt.r[i] * belt.r[i] * belt.r[i]));
+    belt.tilt[i] = tilt(rng);
+    // the scene's asteroid scales
+    belt.radius[i] = (float)((size(rng) / 50.0 + 0.05) * ROCK_RADIUS);
+  }
+}
+
+static bool contactLess(const Contact &a, const Contact &b) {
+  return a.a < b.a || (a.a == b.a && a.b < b.b);
+}
+
+// compares the broadphase with testing every pair, over a few steps
+static bool check(ThreadPool &pool) {
+  Belt belt;
+  makeBelt(belt, 3000);
+  Broadphase broadphase;
+  for (int step = 0; step < 20; step++) {
+    belt.moveTo(step * 256.0 * 50.0);
+    broadphase.update(&belt.x[0], &belt.y[0], &belt.z[0], &belt.radius[0],
+                      belt.r.size(), pool);
+
+    std::vector<Contact> expected;
+    for (uint32_t a = 0; a < belt.r.size(); a++) {
+      for (uint32_t b = a + 1; b < belt.r.size(); b++) {
+        double dx = belt.x[b] - belt.x[a], dy = belt.y[b] - belt.y[a],
+               dz = belt.z[b] - belt.z[a];
+        double touch = belt.radius[a] + belt.radius[b];
+        if (dx * dx + dy * dy + dz * dz <= touch * touch) {
+          Contact contact = {a, b};
+          expected.push_back(contact);
+        }
+      }
+    }
+
+    std::vector<Contact> found = broadphase.contacts;
+    std::sort(found.begin(), found.end(), contactLess);
+    if (found.size() != expected.size() ||
+        !std::equal(found.begin(), found.end(), expected.begin(),
+                    [](const Contact &a, const Contact &b) {
+                      return a.a == b.a && a.b == b.b;
+                    })) {
+      printf("step %d: %zu contacts, %zu expected\n", step, found.size(),
+             expected.size());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back((size_t)atol(argv[i]));
+  if (sizes.empty()) {
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+  }
+
+  ThreadPool pool;
+  if (!check(pool)) {
+    printf("broadphase and brute force disagree\n");
+    return 1;
+  }
+
+  printf("Ring sort and sweep, %u threads, contacts match brute force\n",
+         pool.size());
+  printf("%10s %10s %10s %10s %12s %10s\n", "bodies", "ms/step", "sort ms",
+         "sweep ms", "tests/body", "contacts");
+
+  for (size_t s = 0; s < sizes.size(); s++) {
+    Belt belt;
+    makeBelt(belt, sizes[s]);
+    Broadphase broadphase;
+
+    // the first update sorts from scratch, the timed ones repair the order
+    double t = 0.0;
+    belt.moveTo(t);
+    broadphase.update(&belt.x[0], &belt.y[0], &belt.z[0], &belt.radius[0],
+                      sizes[s], pool);
+
+    int steps = 0;
+    double sort = 0.0, sweep = 0.0, tests = 0.0, contacts = 0.0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (elapsed < 2.0 || steps < 3) {
+      t += 256.0;
+      belt.moveTo(t);
+      broadphase.update(&belt.x[0], &belt.y[0], &belt.z[0], &belt.radius[0],
+                        sizes[s], pool);
+      sort += broadphase.sortSeconds;
+      sweep += broadphase.sweepSeconds;
+      tests += broadphase.tests;
+      contacts += broadphase.contacts.size();
+      steps++;
+      // moving the belt is not part of the cost
+      elapsed += broadphase.sortSeconds + broadphase.sweepSeconds;
+      if (std::chrono::steady_clock::now() - start > std::chrono::seconds(30))
+        break;
+    }
+
+    printf("%10zu %10.3f %10.3f %10.3f %12.1f %10.0f\n", sizes[s],
+           (sort + sweep) / steps * 1000.0, sort / steps * 1000.0,
+           sweep / steps * 1000.0, tests / steps / sizes[s],
+           contacts / steps);
+  }
+  return 0;
+}
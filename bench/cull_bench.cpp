@@ -0,0 +1,146 @@
+// Cost of frustum culling the asteroid belt on the CPU, per frame: every
+// rock's bounding sphere tested against the view, then the visible ones
+// packed into the instance buffer, the work the scene's background job does
+// after moving the belt.
+//
+//   cull_bench [asteroids...]
+//
+// Defaults to 10k, 100k, 1M and 10M asteroids, seen from the Sun with a 45
+// degree lens. Before timing, the vector kernel is checked to keep exactly
+// the rocks a plain one sphere at a time loop keeps.
+#include "asteroids.h"
+#include "bodies.h"
+#include "frustum.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const size_t BLOCKS = 64;
+
+// the plain loop the kernel replaces, kept for comparison
+static size_t cullLoop(const Frustum &frustum, const float *x, const float *y,
+                       const float *z, const float *radius, size_t count,
+                       uint8_t *visible) {
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++) {
+    visible[i] = frustum.contains(x[i], y[i], z[i], radius[i]) ? 1 : 0;
+    kept += visible[i];
+  }
+  return kept;
+}
+
+// best of a few runs, in seconds
+template <typename F> static double timeBest(F run) {
+  double best = HUGE_VAL;
+  for (int k = 0; k < 5; k++) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    run();
+    best = std::min(best, std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<unsigned int> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back((unsigned int)strtoul(argv[i], NULL, 10));
+  if (sizes.empty()) {
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+    sizes.push_back(10000000);
+  }
+
+  // looking from the Sun along the ecliptic x axis, ecliptic y to the right
+  // and z up, through a 45 degree lens from 0.01 to 100 AU. Column major
+  float f = 1.0f / tanf(0.5f * 0.785398163f), aspect = 16.0f / 9.0f;
+  float zNear = 0.01f, zFar = 100.0f;
+  float a = (zFar + zNear) / (zNear - zFar);
+  float b = 2.0f * zFar * zNear / (zNear - zFar);
+  const float viewProjection[16] = {
+      0.0f,       0.0f, -a,   1.0f, //
+      f / aspect, 0.0f, 0.0f, 0.0f, //
+      0.0f,       f,    0.0f, 0.0f, //
+      0.0f,       0.0f, b,    0.0f};
+  Frustum frustum(viewProjection);
+
+  OrbitalElements planets;
+  addPlanets(planets);
+  double gmSun = sunGM(planets);
+  ThreadPool pool;
+
+  printf("Belt frustum culling, %s kernel, %u threads\n", cullKernelName(),
+         pool.size());
+  printf("%10s %9s %12s %12s %16s\n", "asteroids", "in view", "loop ms",
+         "kernel ms", "all + pack ms");
+  for (size_t s = 0; s < sizes.size(); s++) {
+    unsigned int amount = sizes[s];
+    AsteroidField field;
+    generateAsteroidField(field, amount, 0, pool);
+    OrbitalElements orbits;
+    beltElements(orbits, field, gmSun);
+    KeplerPropagator propagator(orbits);
+    std::vector<float> x(amount), y(amount), z(amount), radius(amount);
+    propagator.propagate(0.0, &x[0], &y[0], &z[0]);
+    for (size_t i = 0; i < amount; i++)
+      radius[i] = field.scale[i] * 2.14f / 149.597870f;
+
+    std::vector<uint8_t> expected(amount), visible(amount);
+    size_t kept = cullLoop(frustum, &x[0], &y[0], &z[0], &radius[0], amount,
+                           &expected[0]);
+    if (cullSpheres(frustum, &x[0], &y[0], &z[0], &radius[0], 0, amount,
+                    &visible[0]) != kept ||
+        visible != expected) {
+      printf("%s kernel differs from the loop at %u asteroids\n",
+             cullKernelName(), amount);
+      return 1;
+    }
+
+    std::vector<float> base(16 * (size_t)amount, 0.0f), out(base.size());
+    std::vector<size_t> start(BLOCKS + 1);
+    double loop = timeBest([&]() {
+      cullLoop(frustum, &x[0], &y[0], &z[0], &radius[0], amount, &visible[0]);
+    });
+    double kernel = timeBest([&]() {
+      cullSpheres(frustum, &x[0], &y[0], &z[0], &radius[0], 0, amount,
+                  &visible[0]);
+    });
+    // as the scene does it: blocks culled, counted, then packed in place
+    double all = timeBest([&]() {
+      pool.parallelFor(
+          BLOCKS,
+          [&](size_t first, size_t past) {
+            for (size_t k = first; k < past; k++)
+              start[k + 1] = cullSpheres(frustum, &x[0], &y[0], &z[0],
+                                         &radius[0], amount * k / BLOCKS,
+                                         amount * (k + 1) / BLOCKS,
+                                         &visible[0]);
+          },
+          1);
+      start[0] = 0;
+      for (size_t k = 0; k < BLOCKS; k++)
+        start[k + 1] += start[k];
+      pool.parallelFor(
+          BLOCKS,
+          [&](size_t first, size_t past) {
+            for (size_t k = first; k < past; k++)
+              compactInstances(&base[0], &x[0], &y[0], &z[0], 149.597870f,
+                               &visible[0], amount * k / BLOCKS,
+                               amount * (k + 1) / BLOCKS,
+                               out.data() + 16 * start[k]);
+          },
+          1);
+    });
+    printf("%10u %8.1f%% %12.3f %12.3f %16.3f\n", amount,
+           100.0 * kept / std::max(amount, 1u), loop * 1000.0,
+           kernel * 1000.0, all * 1000.0);
+  }
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Cost of generating the asteroid field at startup, the rand() loop the
+// scene used to run against the counter based generator on every core.
+//
+//   field_bench [asteroids...]
+//
+// Defaults to 10k, 1M and 10M asteroids. Before timing, fields built on one
+// thread and on all of them are checked to be identical.
+#include "asteroids.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const float SCENE_UNITS_PER_AU = 149.597870f;
+
+// the scene's loop before the counter based generator, kept for comparison
+static void randField(AsteroidField &field, unsigned int amount,
+                      unsigned int seed) {
+  field.resize(amount);
+  srand(seed);
+  float asteroidRadius = 3.0f * SCENE_UNITS_PER_AU;
+  float offset = 0.2f * SCENE_UNITS_PER_AU;
+  for (unsigned int i = 0; i < amount; i++) {
+    float angle = (float)i / (float)amount * 360.0f;
+    float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+    float x = sin(angle) * asteroidRadius + displacement;
+    displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+    float y = displacement * 0.4f;
+    displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+    float z = cos(angle) * asteroidRadius + displacement;
+
+    field.x[i] = x / SCENE_UNITS_PER_AU;
+    field.y[i] = -z / SCENE_UNITS_PER_AU;
+    field.z[i] = y / SCENE_UNITS_PER_AU;
+    field.scale[i] = static_cast<float>((rand() % 20) / 50.0 + 0.05);
+    field.rotation[i] = static_cast<float>((rand() % 360));
+  }
+}
+
+static bool sameField(const AsteroidField &a, const AsteroidField &b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z && a.scale == b.scale &&
+         a.rotation == b.rotation;
+}
+
+// best of a few runs, in seconds
+template <typename F> static double timeBest(F run) {
+  double best = HUGE_VAL;
+  for (int k = 0; k < 3; k++) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    run();
+    best = std::min(best, std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<unsigned int> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back((unsigned int)strtoul(argv[i], NULL, 10));
+  if (sizes.empty()) {
+    sizes.push_back(10000);
+    sizes.push_back(1000000);
+    sizes.push_back(10000000);
+  }
+
+  ThreadPool pool, single(1);
+  AsteroidField a, b;
+  generateAsteroidField(a, 100000, 42, pool);
+  generateAsteroidField(b, 100000, 42, single);
+  if (!sameField(a, b)) {
+    printf("fields differ between 1 and %u threads\n", pool.size());
+    return 1;
+  }
+
+  printf("Asteroid field generation, %u threads, same field on 1 thread\n",
+         pool.size());
+  printf("%10s %12s %12s %12s %10s\n", "asteroids", "rand() ms", "1 thread ms",
+         "all ms", "speedup");
+  for (size_t s = 0; s < sizes.size(); s++) {
+    unsigned int amount = sizes[s];
+    AsteroidField field;
+    double loop = timeBest([&]() { randField(field, amount, 42); });
+    double one =
+        timeBest([&]() { generateAsteroidField(field, amount, 42, single); });
+    double all =
+        timeBest([&]() { generateAsteroidField(field, amount, 42, pool); });
+    printf("%10u %12.2f %12.2f %12.2f %9.1fx\n", amount, loop * 1000.0,
+           one * 1000.0, all * 1000.0, loop / all);
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Throughput and energy drift of the symplectic integrators on the Sun and
+// the eight planets.
+//
+//   integrator_bench [steps] [dt...]
+//
+// Runs 1e6 steps per integrator and step length by default. Steps are in
+// ticks; the scene takes 256 tick steps, and at the top of the speed slider a
+// 60 FPS frame covers 1000 ticks.
+#include "bodies.h"
+#include "integrator.h"
+#include "kepler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static void makeSolarSystem(BodyState &state) {
+  OrbitalElements planets;
+  addPlanets(planets);
+  double gmSun = sunGM(planets);
+
+  double origin[3] = {0.0, 0.0, 0.0};
+  state.clear();
+  state.add(origin, origin, gmSun);
+  for (unsigned int k = 0; k < PLANET_COUNT; k++) {
+    double pos[3], vel[3];
+    elementsToState(planets, k, 0.0, gmSun, pos, vel);
+    state.add(pos, vel, gmSun * planetMassRatio[k]);
+  }
+  centreOfMassFrame(state);
+}
+
+int main(int argc, char *argv[]) {
+  long steps = argc > 1 ? atol(argv[1]) : 1000000;
+  std::vector<double> steplengths;
+  for (int i = 2; i < argc; i++)
+    steplengths.push_back(atof(argv[i]));
+  if (steplengths.empty()) {
+    steplengths.push_back(256.0);
+    steplengths.push_back(1024.0);
+    steplengths.push_back(4096.0);
+  }
+
+  IntegratorType types[] = {INTEGRATOR_LEAPFROG, INTEGRATOR_YOSHIDA4};
+
+  printf("Sun and %d planets, %ld steps\n", PLANET_COUNT, steps);
+  printf("%10s %8s %16s %14s %14s\n", "integrator", "dt", "body-steps/s",
+         "final drift", "max drift");
+
+  for (size_t d = 0; d < steplengths.size(); d++) {
+    for (int t = 0; t < 2; t++) {
+      BodyState state;
+      makeSolarSystem(state);
+      double e0 = totalEnergy(state);
+      double maxDrift = 0.0;
+
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      double measured = 0.0;
+      for (long s = 1; s <= steps; s++) {
+        integrate(state, types[t], steplengths[d]);
+        // sampling energy is O(n^2) too, keep it off the clock
+        if (s % 1000 == 0) {
+          measured += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+          double drift = fabs((totalEnergy(state) - e0) / e0);
+          if (drift > maxDrift)
+            maxDrift = drift;
+          start = std::chrono::steady_clock::now();
+        }
+      }
+      measured += std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+      double finalDrift = fabs((totalEnergy(state) - e0) / e0);
+      printf("%10s %8.0f %16.3e %14.3e %14.3e\n", integratorName(types[t]),
+             steplengths[d], steps * (double)state.size() / measured,
+             finalDrift, std::max(maxDrift, finalDrift));
+    }
+  }
+  return 0;
+}
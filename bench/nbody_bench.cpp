@@ -0,0 +1,83 @@
+// Steps per second of the Barnes-Hut asteroid belt at different body counts.
+//
+//   nbody_bench [bodies...]
+//
+// Defaults to 10k, 100k and 1M bodies. Each size runs for at least two
+// seconds of wall time, the belt orbits a Sun and Jupiter like in the scene.
+#include "nbody.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Sun's gravitational parameter in AU^3 / tick^2, the scene's Earth speed
+static const double GM_SUN = 2.7051e-9;
+
+static void makeBelt(NBody &belt, size_t count) {
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<double> radius(2.2, 3.3);
+  std::uniform_real_distribution<double> angle(0.0, 6.283185307179586);
+  std::uniform_real_distribution<double> height(-0.05, 0.05);
+
+  belt.clear();
+  belt.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    double r = radius(rng), phi = angle(rng);
+    double v = sqrt(GM_SUN / r);
+    // the whole belt weighs about 4e-10 solar masses
+    belt.add(r * cos(phi), r * sin(phi), height(rng), -v * sin(phi),
+             v * cos(phi), 0.0, GM_SUN * 4e-10 / count);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; i++)
+    sizes.push_back((size_t)atol(argv[i]));
+  if (sizes.empty()) {
+    sizes.push_back(10000);
+    sizes.push_back(100000);
+    sizes.push_back(1000000);
+  }
+
+  ThreadPool pool;
+  std::vector<Attractor> attractors;
+  Attractor sun = {0.0, 0.0, 0.0, GM_SUN};
+  Attractor jupiter = {5.2, 0.0, 0.0, GM_SUN * 9.546e-4};
+  attractors.push_back(sun);
+  attractors.push_back(jupiter);
+
+  printf("Barnes-Hut belt, theta 0.7, %u threads\n", pool.size());
+  printf("%10s %10s %12s %12s %12s\n", "bodies", "steps/s", "build ms",
+         "force ms", "cells");
+
+  for (size_t s = 0; s < sizes.size(); s++) {
+    NBody belt;
+    makeBelt(belt, sizes[s]);
+
+    // one warm up step so allocations are out of the way
+    belt.step(256.0, attractors, pool);
+
+    int steps = 0;
+    double build = 0.0, force = 0.0;
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (elapsed < 2.0 || steps < 3) {
+      belt.step(256.0, attractors, pool);
+      build += belt.buildSeconds;
+      force += belt.forceSeconds;
+      steps++;
+      elapsed = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    }
+
+    printf("%10zu %10.2f %12.2f %12.2f %12zu\n", sizes[s], steps / elapsed,
+           build / steps * 1000.0, force / steps * 1000.0, belt.treeSize());
+  }
+  return 0;
+}
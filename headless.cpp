@@ -0,0 +1,277 @@
+// Runs the simulation without a window or GL context, as fast as it goes.
+//
+//   solarsystem_headless [--steps N] [--dt ticks] [--asteroids N]
+//                        [--belt kepler|nbody|none] [--seed N] [--every N]
+//                        [--out file|-]
+//   solarsystem_headless --replay file
+//
+// Steps the same fixed timestep clock as the scene (256 tick steps by
+// default) and, with --out, streams the state of every body to a file, or to
+// stdout for "-". Throughput goes to stderr.
+//
+// The stream is little endian: a header
+//
+//   char magic[4] = "SSIM"; uint32 version = 1; uint32 bodies;
+//   uint32 every; double step;
+//
+// then one frame every `every` steps: double time (ticks) followed by float
+// x[bodies], y[bodies], z[bodies], ecliptic positions in AU. Bodies are the
+// eight planets first, in Planet order, then the asteroids.
+//
+// --replay plays a log recorded with `solarsystem --record file`: its frame
+// times and speeds drive the clock as they did the scene's, the belt falls
+// under gravity when the recording had it on, and every frame's simulation
+// time is checked against the recorded one.
+#include "planet/asteroids.h"
+#include "planet/bodies.h"
+#include "planet/clock.h"
+#include "planet/kepler.h"
+#include "planet/nbody.h"
+#include "planet/parallel.h"
+#include "planet/replay.h"
+#include "planet/warp.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+enum BeltMode { BELT_NONE, BELT_KEPLER, BELT_NBODY };
+
+static void usage() {
+  fprintf(stderr, "usage: solarsystem_headless [--steps N] [--dt ticks] "
+                  "[--asteroids N]\n"
+                  "                            [--belt kepler|nbody|none] "
+                  "[--seed N] [--every N]\n"
+                  "                            [--out file|-]\n"
+                  "       solarsystem_headless --replay file\n");
+}
+
+// plays a recording back at its frame times, as fast as it goes
+static int replay(const char *path) {
+  ReplayPlayer player;
+  if (!player.open(path))
+    return 1;
+
+  OrbitalElements planetElements;
+  addPlanets(planetElements);
+  KeplerPropagator planetPropagator(planetElements);
+  double gmSun = sunGM(planetElements);
+  std::vector<float> x(PLANET_COUNT), y(PLANET_COUNT), z(PLANET_COUNT);
+
+  ThreadPool workers;
+  AsteroidField field;
+  generateAsteroidField(field, player.header.asteroids, player.header.seed,
+                        workers);
+  NBody belt;
+  TimeWarp warp;
+  std::vector<Attractor> attractors(PLANET_COUNT + 1);
+  auto beltAttractors = [&](double t) -> const std::vector<Attractor> & {
+    planetPropagator.propagate(t, &x[0], &y[0], &z[0]);
+    Attractor sun = {0.0, 0.0, 0.0, gmSun};
+    attractors[0] = sun;
+    for (unsigned int k = 0; k < PLANET_COUNT; k++) {
+      Attractor planet = {x[k], y[k], z[k], gmSun * planetMassRatio[k]};
+      attractors[k + 1] = planet;
+    }
+    return attractors;
+  };
+
+  // the scene's clock, fed the recorded frames
+  SimClock simClock(player.header.step, player.header.ticksPerSecond);
+  bool gravity = false;
+  unsigned long steps = 0, mismatches = 0;
+  ReplayFrame frame;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  while (player.next(frame)) {
+    bool on = (frame.toggles & REPLAY_ASTEROID_GRAVITY) != 0;
+    if (on && !gravity) {
+      startBelt(belt, field, gmSun);
+      warp.start(belt, gmSun, simClock.time);
+    }
+    gravity = on;
+
+    simClock.rate = player.header.ticksPerSecond * frame.speedModifier;
+    simClock.accumulate(frame.delta);
+    while (simClock.tick())
+      steps++;
+    if (gravity)
+      warp.advance(belt, simClock.previous, simClock.time, gmSun,
+                   beltAttractors, workers);
+    if (simClock.renderTime() != frame.time)
+      mismatches++;
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  double earthYear = 2.0 * M_PI / planetElements.n[EARTH];
+  fprintf(stderr,
+          "%zu frames, %lu steps of %.0f ticks, %u asteroids\n"
+          "%.3f s, %.0f frames/s, %.1f years simulated\n"
+          "%lu frames off the recorded time\n",
+          player.frameCount(), steps, player.header.step,
+          player.header.asteroids, seconds, player.frameCount() / seconds,
+          simClock.time / earthYear, mismatches);
+  return mismatches == 0 ? 0 : 1;
+}
+
+int main(int argc, const char *argv[]) {
+  unsigned long steps = 10000;
+  double dt = 256.0;
+  unsigned int amount = 10000;
+  BeltMode mode = BELT_KEPLER;
+  unsigned int seed = 0;
+  unsigned int every = 1;
+  const char *outPath = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    const char *value = argv[++i];
+    if (arg == "--replay")
+      return replay(value);
+    else if (arg == "--steps")
+      steps = strtoul(value, NULL, 10);
+    else if (arg == "--dt")
+      dt = atof(value);
+    else if (arg == "--asteroids")
+      amount = (unsigned int)strtoul(value, NULL, 10);
+    else if (arg == "--seed")
+      seed = (unsigned int)strtoul(value, NULL, 10);
+    else if (arg == "--every")
+      every = (unsigned int)strtoul(value, NULL, 10);
+    else if (arg == "--out")
+      outPath = value;
+    else if (arg == "--belt" && strcmp(value, "kepler") == 0)
+      mode = BELT_KEPLER;
+    else if (arg == "--belt" && strcmp(value, "nbody") == 0)
+      mode = BELT_NBODY;
+    else if (arg == "--belt" && strcmp(value, "none") == 0)
+      mode = BELT_NONE;
+    else {
+      usage();
+      return 1;
+    }
+  }
+  if (dt <= 0.0 || every == 0) {
+    usage();
+    return 1;
+  }
+  if (mode == BELT_NONE)
+    amount = 0;
+
+  OrbitalElements planetElements;
+  addPlanets(planetElements);
+  KeplerPropagator planetPropagator(planetElements);
+  double gmSun = sunGM(planetElements);
+
+  ThreadPool workers;
+  AsteroidField field;
+  generateAsteroidField(field, amount, seed, workers);
+  OrbitalElements beltOrbits;
+  KeplerPropagator beltPropagator;
+  NBody belt;
+  std::vector<Attractor> attractors(PLANET_COUNT + 1);
+  if (mode == BELT_KEPLER) {
+    beltElements(beltOrbits, field, gmSun);
+    beltPropagator.setElements(beltOrbits);
+  } else if (mode == BELT_NBODY) {
+    startBelt(belt, field, gmSun);
+  }
+
+  size_t bodies = PLANET_COUNT + amount;
+  std::vector<float> x(bodies), y(bodies), z(bodies);
+
+  FILE *out = NULL;
+  if (outPath != NULL) {
+    out = strcmp(outPath, "-") == 0 ? stdout : fopen(outPath, "wb");
+    if (out == NULL) {
+      fprintf(stderr, "could not open %s\n", outPath);
+      return 1;
+    }
+    uint32_t header[3] = {1, (uint32_t)bodies, every};
+    fwrite("SSIM", 1, 4, out);
+    fwrite(header, sizeof(uint32_t), 3, out);
+    fwrite(&dt, sizeof(double), 1, out);
+  }
+
+  // the whole run is accumulated at once and consumed step by step, which is
+  // what the render loop does a frame at a time
+  SimClock simClock(dt, 1.0, 0);
+  simClock.accumulate(steps * dt);
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  double bytes = 0.0;
+  unsigned long step = 0;
+  while (simClock.tick()) {
+    step++;
+    bool record = out != NULL && step % every == 0;
+
+    if (mode == BELT_NBODY) {
+      planetPropagator.propagate(simClock.time - simClock.step * 0.5, &x[0],
+                                 &y[0], &z[0]);
+      Attractor sun = {0.0, 0.0, 0.0, gmSun};
+      attractors[0] = sun;
+      for (unsigned int k = 0; k < PLANET_COUNT; k++) {
+        Attractor planet = {x[k], y[k], z[k], gmSun * planetMassRatio[k]};
+        attractors[k + 1] = planet;
+      }
+      belt.step(simClock.step, attractors, workers);
+    }
+
+    double t = simClock.time;
+    planetPropagator.propagate(t, &x[0], &y[0], &z[0]);
+    if (mode == BELT_KEPLER) {
+      workers.parallelFor(amount, [&](size_t begin, size_t end) {
+        beltPropagator.propagateRange(t, begin, end, &x[PLANET_COUNT],
+                                      &y[PLANET_COUNT], &z[PLANET_COUNT]);
+      });
+    } else if (mode == BELT_NBODY) {
+      for (size_t i = 0; i < amount; i++) {
+        x[PLANET_COUNT + i] = (float)belt.x[i];
+        y[PLANET_COUNT + i] = (float)belt.y[i];
+        z[PLANET_COUNT + i] = (float)belt.z[i];
+      }
+    }
+
+    if (!record)
+      continue;
+    fwrite(&t, sizeof(double), 1, out);
+    fwrite(&x[0], sizeof(float), bodies, out);
+    fwrite(&y[0], sizeof(float), bodies, out);
+    fwrite(&z[0], sizeof(float), bodies, out);
+    bytes += sizeof(double) + 3.0 * sizeof(float) * bodies;
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  if (out != NULL && out != stdout)
+    fclose(out);
+  else if (out != NULL)
+    fflush(out);
+
+  double earthYear = 2.0 * M_PI / planetElements.n[EARTH];
+  fprintf(stderr,
+          "%lu steps of %.0f ticks, %zu bodies, %s belt\n"
+          "%.3f s, %.0f steps/s, %.3g body-steps/s\n"
+          "%.1f years simulated, %.1f years per second\n",
+          step, dt, bodies,
+          mode == BELT_NBODY ? "nbody" : mode == BELT_KEPLER ? "kepler"
+                                                             : "no",
+          seconds, step / seconds, step * (double)bodies / seconds,
+          simClock.time / earthYear, simClock.time / earthYear / seconds);
+  if (out != NULL)
+    fprintf(stderr, "%.1f MB written\n", bytes / (1024.0 * 1024.0));
+  return 0;
+}
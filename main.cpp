@@ -1,7 +1,16 @@
 #include "planet/planet.hpp"
+#include <cstring>
 #include <iostream>
 
 int main(int argc, const char *argv[]) {
-  system();
-  return 0;
+  const char *recordPath = NULL, *replayPath = NULL, *resumePath = NULL;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--record") == 0)
+      recordPath = argv[i + 1];
+    else if (strcmp(argv[i], "--replay") == 0)
+      replayPath = argv[i + 1];
+    else if (strcmp(argv[i], "--resume") == 0)
+      resumePath = argv[i + 1];
+  }
+  return system(recordPath, replayPath, resumePath);
 }
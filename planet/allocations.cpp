@@ -0,0 +1,29 @@
+#include "allocations.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> count(0), bytes(0);
+
+size_t allocationCount() { return count.load(std::memory_order_relaxed); }
+
+size_t allocatedBytes() { return bytes.load(std::memory_order_relaxed); }
+
+// The array and nothrow forms of the library call this one, so it sees
+// every allocation made with new
+void *operator new(std::size_t size) {
+  count.fetch_add(1, std::memory_order_relaxed);
+  bytes.fetch_add(size, std::memory_order_relaxed);
+  void *p = malloc(size == 0 ? 1 : size);
+  while (p == NULL) {
+    std::new_handler handler = std::get_new_handler();
+    if (handler == NULL)
+      throw std::bad_alloc();
+    handler();
+    p = malloc(size == 0 ? 1 : size);
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
@@ -0,0 +1,13 @@
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <cstddef>
+
+// Heap allocations made through operator new by any thread since the
+// program started, and their total size in bytes. allocations.cpp replaces
+// the global operator new to count them, link it into the program whose
+// allocations should be counted. Sample twice and subtract for a frame.
+size_t allocationCount();
+size_t allocatedBytes();
+
+#endif
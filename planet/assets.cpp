@@ -0,0 +1,86 @@
+#include "assets.h"
+
+#include "model.h"
+#include "shader.h"
+
+// position of path in paths, or paths.size()
+static size_t find(const std::vector<std::string> &paths,
+                   const std::string &path) {
+  size_t i = 0;
+  while (i < paths.size() && paths[i] != path)
+    i++;
+  return i;
+}
+
+AssetRegistry::AssetRegistry() {}
+
+AssetRegistry::~AssetRegistry() {
+  if (!shaders.empty() || !models.empty() || !textures.empty())
+    std::cout << "ERROR::ASSETS::NOT_RELEASED" << std::endl;
+}
+
+ShaderHandle AssetRegistry::shader(const std::string &vertexPath,
+                                   const std::string &fragmentPath) {
+  std::string key = vertexPath + '\n' + fragmentPath;
+  size_t i = find(shaderPaths, key);
+  if (i == shaderPaths.size()) {
+    shaders.emplace_back(
+        new Shader(vertexPath.c_str(), fragmentPath.c_str()));
+    shaderPaths.push_back(key);
+  }
+  return ShaderHandle((uint32_t)i);
+}
+
+ShaderHandle
+AssetRegistry::feedbackShader(const std::string &vertexPath,
+                              const std::string &geometryPath,
+                              const std::vector<std::string> &captured) {
+  std::string key = vertexPath + '\n' + geometryPath;
+  for (size_t k = 0; k < captured.size(); k++)
+    key += '\n' + captured[k];
+  size_t i = find(shaderPaths, key);
+  if (i == shaderPaths.size()) {
+    shaders.emplace_back(
+        new Shader(vertexPath.c_str(), geometryPath.c_str(), captured));
+    shaderPaths.push_back(key);
+  }
+  return ShaderHandle((uint32_t)i);
+}
+
+ModelHandle AssetRegistry::model(const std::string &path) {
+  size_t i = find(modelPaths, path);
+  if (i == modelPaths.size()) {
+    models.emplace_back(new Model(path));
+    modelPaths.push_back(path);
+  }
+  return ModelHandle((uint32_t)i);
+}
+
+TextureHandle AssetRegistry::texture(const std::string &path) {
+  size_t i = find(texturePaths, path);
+  if (i == texturePaths.size()) {
+    textures.push_back(TextureFromFile(path.c_str(), "."));
+    texturePaths.push_back(path);
+  }
+  return TextureHandle((uint32_t)i);
+}
+
+void AssetRegistry::release() {
+  while (!textures.empty()) {
+    glDeleteTextures(1, &textures.back());
+    textures.pop_back();
+  }
+  texturePaths.clear();
+
+  while (!models.empty()) {
+    models.back()->release();
+    models.pop_back();
+  }
+  modelPaths.clear();
+
+  while (!shaders.empty()) {
+    glDeleteProgram(shaders.back()->ID);
+    shaders.pop_back();
+  }
+  shaderPaths.clear();
+}
@@ -0,0 +1,76 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Model;
+class Shader;
+
+// A handle to something the registry owns: an index into its table, typed
+// so a model handle cannot be used for a shader. Cheap to copy and store
+template <typename T> struct AssetHandle {
+  uint32_t index;
+  AssetHandle() : index(UINT32_MAX) {}
+  explicit AssetHandle(uint32_t index) : index(index) {}
+  bool valid() const { return index != UINT32_MAX; }
+};
+
+struct TextureAsset;
+typedef AssetHandle<Model> ModelHandle;
+typedef AssetHandle<Shader> ShaderHandle;
+typedef AssetHandle<TextureAsset> TextureHandle;
+
+// Owns the models (and through them their meshes and textures), the loose
+// textures and the shader programs of the scene. Each is loaded once per
+// file, later requests for the same file get the same handle, and the rest
+// of the scene refers to them by handle or by reference, never by copy.
+//
+// release() frees every GL object the registry owns: textures, then models
+// with their meshes and textures, then programs. It has to run while the
+// context is still current, so it is called explicitly before the window
+// goes rather than left to the destructor.
+class AssetRegistry {
+public:
+  AssetRegistry();
+  ~AssetRegistry();
+
+  ShaderHandle shader(const std::string &vertexPath,
+                      const std::string &fragmentPath);
+  // a transform feedback program capturing the named outputs, see shader.h
+  ShaderHandle feedbackShader(const std::string &vertexPath,
+                              const std::string &geometryPath,
+                              const std::vector<std::string> &captured);
+  ModelHandle model(const std::string &path);
+  // a texture file, relative to the working directory
+  TextureHandle texture(const std::string &path);
+
+  Shader &operator[](ShaderHandle handle) { return *shaders[handle.index]; }
+  Model &operator[](ModelHandle handle) { return *models[handle.index]; }
+  GLuint operator[](TextureHandle handle) const {
+    return textures[handle.index];
+  }
+
+  size_t shaderCount() const { return shaders.size(); }
+  size_t modelCount() const { return models.size(); }
+  size_t textureCount() const { return textures.size(); }
+
+  void release();
+
+private:
+  AssetRegistry(const AssetRegistry &);
+  AssetRegistry &operator=(const AssetRegistry &);
+
+  std::vector<std::unique_ptr<Shader>> shaders;
+  std::vector<std::string> shaderPaths;
+  std::vector<std::unique_ptr<Model>> models;
+  std::vector<std::string> modelPaths;
+  std::vector<GLuint> textures;
+  std::vector<std::string> texturePaths;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "asteroids.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "bodies.h"
+#include "random.h"
+
+// The field was laid out in scene units, which are 1e6 km
+static const float SCENE_UNITS_PER_AU = 149.597870f;
+
+void AsteroidField::resize(size_t count) {
+  x.resize(count);
+  y.resize(count);
+  z.resize(count);
+  scale.resize(count);
+  rotation.resize(count);
+}
+
+void generateAsteroidField(AsteroidField &field, unsigned int amount,
+                           unsigned int seed, ThreadPool &pool) {
+  field.resize(amount);
+  Philox random(seed);
+  float asteroidRadius = 3.0f * SCENE_UNITS_PER_AU;
+  float offset = 0.2f * SCENE_UNITS_PER_AU;
+  pool.parallelFor(amount, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      // one block per asteroid, its index is the counter
+      uint32_t bits[4];
+      random.block(i, 0, bits);
+
+      // 1. translation: displace along circle with 'radius' in range
+      // [-offset, offset]
+      float angle = (float)i / (float)amount * 360.0f;
+      float x = sin(angle) * asteroidRadius +
+                (Philox::uniform(bits[0]) * 2.0f - 1.0f) * offset;
+      // keep height of asteroid field smaller compared to width of x and z
+      float y = (Philox::uniform(bits[1]) * 2.0f - 1.0f) * offset * 0.4f;
+      float z = cos(angle) * asteroidRadius +
+                (Philox::uniform(bits[2]) * 2.0f - 1.0f) * offset;
+
+      // scene axes are y up, the ecliptic frame is z up
+      field.x[i] = x / SCENE_UNITS_PER_AU;
+      field.y[i] = -z / SCENE_UNITS_PER_AU;
+      field.z[i] = y / SCENE_UNITS_PER_AU;
+
+      // 2. scale: Scale between 0.05 and 0.50f
+      field.scale[i] = static_cast<float>((bits[3] % 20) / 50.0 + 0.05);
+
+      // 3. rotation: random angle around a (semi)randomly picked axis
+      field.rotation[i] = static_cast<float>(bits[3] / 20 % 360);
+    }
+  });
+}
+
+void placeInstances(const float *base, const float *x, const float *y,
+                    const float *z, float unit, size_t begin, size_t end,
+                    float *out) {
+  for (size_t i = begin; i < end; i++) {
+    const float *from = base + 16 * i;
+    float *to = out + 16 * i;
+    for (int k = 0; k < 12; k++)
+      to[k] = from[k];
+    // ecliptic to the scene's frame, as eclipticToWorld() does
+    to[12] = x[i] * unit;
+    to[13] = z[i] * unit;
+    to[14] = -y[i] * unit;
+    to[15] = 1.0f;
+  }
+}
+
+size_t compactInstances(const float *base, const float *x, const float *y,
+                        const float *z, float unit, const uint8_t *visible,
+                        size_t begin, size_t end, float *out) {
+  float *to = out;
+  for (size_t i = begin; i < end; i++) {
+    if (!visible[i])
+      continue;
+    const float *from = base + 16 * i;
+    for (int k = 0; k < 12; k++)
+      to[k] = from[k];
+    to[12] = x[i] * unit;
+    to[13] = z[i] * unit;
+    to[14] = -y[i] * unit;
+    to[15] = 1.0f;
+    to += 16;
+  }
+  return (to - out) / 16;
+}
+
+// an angle reduced to [0, 2 pi)
+static double wrapAngle(double angle) {
+  const double TWO_PI = 6.283185307179586;
+  angle = fmod(angle, TWO_PI);
+  return angle < 0.0 ? angle + TWO_PI : angle;
+}
+
+static int16_t packUnit(double v) {
+  return (int16_t)floor(v * 32767.0 + 0.5);
+}
+
+void orbitInstances(const OrbitalElements &elements, const AsteroidField &field,
+                    unsigned int seed, double epoch, size_t begin, size_t end,
+                    OrbitInstance *out) {
+  const double PI = 3.141592653589793;
+  Philox random(seed);
+  for (size_t i = begin; i < end; i++) {
+    OrbitInstance &o = out[i];
+    o.a = (float)elements.a[i];
+    o.e = (float)elements.e[i];
+    o.M = (float)wrapAngle(elements.M0[i] + elements.n[i] * epoch);
+    o.n = (float)elements.n[i];
+
+    // Rz(node) Rx(inc) Rz(peri), the rotation KeplerPropagator builds its
+    // P and Q vectors from
+    double sum = 0.5 * (elements.node[i] + elements.peri[i]);
+    double diff = 0.5 * (elements.node[i] - elements.peri[i]);
+    double ci = cos(0.5 * elements.inc[i]), si = sin(0.5 * elements.inc[i]);
+    o.q[0] = packUnit(si * cos(diff));
+    o.q[1] = packUnit(si * sin(diff));
+    o.q[2] = packUnit(ci * sin(sum));
+    o.q[3] = packUnit(ci * cos(sum));
+
+    // the field's stream 0 made the rock, stream 1 spins it
+    uint32_t bits[4];
+    random.block(i, 1, bits);
+    o.turns = packUnit(Philox::uniform(bits[0]) * 2.0 - 1.0);
+    o.scale = packUnit(field.scale[i]);
+    o.unused = 0;
+
+    // the rate as the shader decodes it, so the angle carries on smoothly
+    // when the epoch moves
+    double rate = o.turns / 32767.0 * ORBIT_INSTANCE_MAX_TURNS * o.n;
+    double spin = wrapAngle(field.rotation[i] + rate * epoch);
+    o.spin = packUnit((spin > PI ? spin - 2.0 * PI : spin) / PI);
+  }
+}
+
+// velocity of a circular orbit through pos, parallel to the ecliptic
+static void circularVelocity(const double pos[3], double gmSun,
+                             double vel[3]) {
+  double r = sqrt(pos[0] * pos[0] + pos[1] * pos[1] + pos[2] * pos[2]);
+  double rxy = sqrt(pos[0] * pos[0] + pos[1] * pos[1]);
+  double v = sqrt(gmSun / r);
+  vel[0] = -v * pos[1] / rxy;
+  vel[1] = v * pos[0] / rxy;
+  vel[2] = 0.0;
+}
+
+void startBelt(NBody &belt, const AsteroidField &field, double gmSun) {
+  belt.clear();
+  belt.reserve(field.size());
+  double gm = gmSun * beltMassRatio / field.size();
+  for (size_t i = 0; i < field.size(); i++) {
+    double pos[3] = {field.x[i], field.y[i], field.z[i]};
+    double vel[3];
+    circularVelocity(pos, gmSun, vel);
+    belt.add(pos[0], pos[1], pos[2], vel[0], vel[1], vel[2], gm);
+  }
+}
+
+void beltElements(OrbitalElements &elements, const AsteroidField &field,
+                  double gmSun) {
+  elements.clear();
+  elements.reserve(field.size());
+  for (size_t i = 0; i < field.size(); i++) {
+    double pos[3] = {field.x[i], field.y[i], field.z[i]};
+    double vel[3];
+    circularVelocity(pos, gmSun, vel);
+    stateToElements(elements, pos, vel, gmSun, 0.0);
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef ASTEROIDS_H
+#define ASTEROIDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kepler.h"
+#include "nbody.h"
+#include "parallel.h"
+
+// Asteroid instances without anything GL: position in the ecliptic frame (AU),
+// size and spin angle of each rock. The renderer turns them into instance
+// matrices, the headless runner and N-body mode use them as initial state.
+struct AsteroidField {
+  std::vector<float> x, y, z;
+  std::vector<float> scale;
+  std::vector<float> rotation;
+
+  size_t size() const { return x.size(); }
+  void resize(size_t count);
+};
+
+// The belt the scene has always drawn: a ring 3 AU out, 0.2 AU thick and
+// flattened vertically. Every asteroid draws its numbers from a counter based
+// generator keyed by seed, with its index as the counter, so the field is the
+// same for a seed however many threads build it
+void generateAsteroidField(AsteroidField &field, unsigned int amount,
+                           unsigned int seed, ThreadPool &pool);
+
+// Moves instance matrices to new positions. base and out hold 16 floats per
+// asteroid, column major like glm: out[i] is base[i] with its translation
+// replaced by (x[i], y[i], z[i]), ecliptic AU, in the scene's y up frame at
+// unit world units per AU. For asteroids [begin, end)
+void placeInstances(const float *base, const float *x, const float *y,
+                    const float *z, float unit, size_t begin, size_t end,
+                    float *out);
+
+// placeInstances() for the asteroids of [begin, end) with visible[i] set
+// only, written one after the other from out on. Returns how many
+size_t compactInstances(const float *base, const float *x, const float *y,
+                        const float *z, float unit, const uint8_t *visible,
+                        size_t begin, size_t end, float *out);
+
+// One asteroid as asteroids.vs moves it along its orbit on its own, 32 bytes
+// instead of a 64 byte matrix. The shorts are read as plain integers and
+// divided by 32767 in the shader, so both sides agree on them exactly
+struct OrbitInstance {
+  float a;       // semi-major axis, AU
+  float e;       // eccentricity
+  float M;       // mean anomaly at the epoch, [0, 2 pi)
+  float n;       // mean motion, radians per tick
+  int16_t q[4];  // unit quaternion x, y, z, w turning the orbit's frame,
+                 // periapsis along x, into the ecliptic
+  int16_t scale; // size of the rock, [0, 1)
+  int16_t spin;  // spin angle at the epoch over pi
+  int16_t turns; // spin turns per lap over ORBIT_INSTANCE_MAX_TURNS
+  int16_t unused;
+};
+
+// fastest a rock spins, in turns per lap around the Sun
+const float ORBIT_INSTANCE_MAX_TURNS = 16.0f;
+
+// Packs asteroids [begin, end) for the shader: their orbits, their sizes and
+// starting spin angles from the field, and a spin rate drawn from seed. Mean
+// anomalies and spin angles are moved to time epoch, so the shader only has
+// to add what happened since, which keeps its float time small
+void orbitInstances(const OrbitalElements &elements, const AsteroidField &field,
+                    unsigned int seed, double epoch, size_t begin, size_t end,
+                    OrbitInstance *out);
+
+// Seeds an N-body belt from the field, each asteroid on a circular orbit
+// around the Sun
+void startBelt(NBody &belt, const AsteroidField &field, double gmSun);
+
+// Orbital elements of the same circular orbits, for propagating the belt
+// analytically instead
+void beltElements(OrbitalElements &elements, const AsteroidField &field,
+                  double gmSun);
+
+#endif
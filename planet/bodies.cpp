@@ -0,0 +1,48 @@
+#include "bodies.h"
+
+static const double DEG = 0.017453292519943295;
+
+// Mean motions are in the units the scene was tuned in, 1e-4 degrees per tick
+static const double SPEED_UNIT = 0.0001;
+
+const char *planetNames[PLANET_COUNT] = {"Mercury", "Venus",  "Earth",
+                                         "Mars",    "Jupiter", "Saturn",
+                                         "Uranus",  "Neptune"};
+
+const double planetMassRatio[PLANET_COUNT] = {
+    1.660e-7, 2.448e-6, 3.003e-6, 3.227e-7,
+    9.546e-4, 2.858e-4, 4.366e-5, 5.151e-5};
+
+const double beltMassRatio = 1.2e-9;
+
+size_t addPlanet(OrbitalElements &elements, double a, double speed, double e,
+                 double inc, double node, double peri) {
+  node *= DEG;
+  peri *= DEG;
+  return elements.add(a, e, inc * DEG, node, peri, -(node + peri),
+                      speed * SPEED_UNIT * DEG);
+}
+
+void addPlanets(OrbitalElements &elements) {
+  static const struct {
+    double a, speed, e, inc, node, peri;
+  } planets[PLANET_COUNT] = {
+      {0.39, 49.9, 0.2056, 7.00, 48.33, 29.12},
+      {0.72, 35.0, 0.0068, 3.39, 76.68, 54.88},
+      {1.00, 29.8, 0.0167, 0.00, -11.26, 114.21},
+      {1.52, 24.1, 0.0934, 1.85, 49.56, 286.50},
+      {5.20, 13.1, 0.0489, 1.30, 100.46, 273.87},
+      {9.54, 9.7, 0.0565, 2.49, 113.67, 339.39},
+      {14.22, 6.8, 0.0463, 0.77, 74.01, 96.99},
+      {23.06, 5.4, 0.0095, 1.77, 131.78, 276.34},
+  };
+
+  for (unsigned int k = 0; k < PLANET_COUNT; k++)
+    addPlanet(elements, planets[k].a, planets[k].speed, planets[k].e,
+              planets[k].inc, planets[k].node, planets[k].peri);
+}
+
+double sunGM(const OrbitalElements &planets, size_t earth) {
+  return planets.n[earth] * planets.n[earth] * planets.a[earth] *
+         planets.a[earth] * planets.a[earth];
+}
@@ -0,0 +1,45 @@
+#ifndef BODIES_H
+#define BODIES_H
+
+#include "kepler.h"
+
+// The planets of the scene, in the order they are drawn
+enum Planet {
+  MERCURY,
+  VENUS,
+  EARTH,
+  MARS,
+  JUPITER,
+  SATURN,
+  URANUS,
+  NEPTUNE,
+  PLANET_COUNT
+};
+
+extern const char *planetNames[PLANET_COUNT];
+
+// Masses relative to the Sun
+extern const double planetMassRatio[PLANET_COUNT];
+// Total mass of the main asteroid belt relative to the Sun
+extern const double beltMassRatio;
+
+// Appends one planet and returns its index. speed is the mean motion in the
+// scene's old units of 1e-4 degrees per tick, angles are in degrees. The mean
+// anomaly starts where the mean longitude is zero
+size_t addPlanet(OrbitalElements &elements, double a, double speed, double e,
+                 double inc, double node, double peri);
+
+// The scene reads its planets from resources/bodies.json, the built in set
+// below keeps the headless tools free of files.
+//
+// Appends the planets to elements, indexed by Planet. Orbit sizes are the
+// radiuses the scene always used and mean motions the old per tick speeds,
+// the remaining elements are the real J2000 ones. Mean anomalies start where
+// every planet has a mean longitude of zero, lined up like they used to be
+void addPlanets(OrbitalElements &elements);
+
+// The Sun's gravitational parameter in AU^3 / tick^2, chosen so Earth's orbit
+// (planets[earth]) takes as long as its mean motion says
+double sunGM(const OrbitalElements &planets, size_t earth = EARTH);
+
+#endif
@@ -0,0 +1,271 @@
+#include "broadphase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// angles are pseudo angles, see pseudoAngle(), and go round in 4
+static const double TURN = 4.0;
+static const double HALF_TURN = 2.0;
+// pseudo angles are compared after a subtraction, leave room for its rounding
+static const double ANGLE_SLACK = 1e-9;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Diamond angle of (x, y) in [-2, 2]: grows with the angle around the origin,
+// a quarter turn every 1, and never faster than the angle in radians does, so
+// angular distances are safe bounds on pseudo angle distances. Costs two
+// divisions against the atan2() it stands for
+static double pseudoAngle(double x, double y) {
+  double sum = fabs(x) + fabs(y);
+  if (sum == 0.0)
+    return 0.0;
+  // the left half picks its side without a branch, which side an asteroid
+  // is on is a coin toss for the predictor
+  double q = x / sum;
+  return x >= 0.0 ? y / sum : copysign(1.0 - q, y);
+}
+
+// cheap when [begin, end) is nearly sorted already, which it is from one step
+// to the next
+template <typename T> static void insertionSort(T *begin, T *end) {
+  for (T *i = begin + 1; i < end; i++) {
+    if (!(*i < *(i - 1)))
+      continue;
+    T moving = *i;
+    T *j = i;
+    do {
+      *j = *(j - 1);
+      j--;
+    } while (j > begin && moving < *(j - 1));
+    *j = moving;
+  }
+}
+
+void Broadphase::update(const double *x, const double *y, const double *z,
+                        const float *radius, size_t count, ThreadPool &pool) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  sort(x, y, radius, count, pool);
+  sortSeconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  sweep(x, y, z, radius, pool);
+  sweepSeconds = secondsSince(start);
+}
+
+void Broadphase::sort(const double *x, const double *y, const float *radius,
+                      size_t count, ThreadPool &pool) {
+  double largest = 0.0;
+  for (size_t i = 0; i < count; i++)
+    largest = std::max(largest, (double)radius[i]);
+
+  // rings wider than needed only cost tests, keep them until they are twice
+  // too wide so the order survives small changes of radius
+  double width = std::max(2.0 * largest, 1e-12);
+  bool fresh = entries.size() != count || width > ringWidth ||
+               width < 0.5 * ringWidth;
+  if (fresh)
+    ringWidth = width;
+  auto ringAt = [&](size_t i) {
+    double r = sqrt(x[i] * x[i] + y[i] * y[i]) / ringWidth;
+    return (int32_t)std::min(r, 1e9);
+  };
+
+  if (fresh) {
+    entries.resize(count);
+    pool.parallelFor(count, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        entries[i].ring = ringAt(i);
+        entries[i].body = (uint32_t)i;
+        entries[i].angle = pseudoAngle(x[i], y[i]);
+      }
+    });
+    std::sort(entries.begin(), entries.end());
+  } else {
+    moved.resize(count);
+    pool.parallelFor(count, [&](size_t begin, size_t end) {
+      for (size_t k = begin; k < end; k++) {
+        Entry &entry = entries[k];
+        int32_t ring = ringAt(entry.body);
+        double angle = pseudoAngle(x[entry.body], y[entry.body]);
+        moved[k] = ring != entry.ring || fabs(angle - entry.angle) > HALF_TURN;
+        entry.ring = ring;
+        entry.angle = angle;
+      }
+    });
+
+    kept.clear();
+    crossed.clear();
+    for (size_t k = 0; k < count; k++)
+      (moved[k] ? crossed : kept).push_back(entries[k]);
+
+    if (!kept.empty()) {
+      Entry *first = &kept[0];
+      size_t size = kept.size();
+      size_t blocks = pool.size() * 4;
+      pool.parallelFor(
+          blocks,
+          [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; b++)
+              insertionSort(first + size * b / blocks,
+                            first + size * (b + 1) / blocks);
+          },
+          1);
+      // only bodies that moved past a block boundary are left out of place
+      insertionSort(first, first + size);
+    }
+    std::sort(crossed.begin(), crossed.end());
+    std::merge(kept.begin(), kept.end(), crossed.begin(), crossed.end(),
+               entries.begin());
+  }
+
+  rings.clear();
+  ringOf.resize(count);
+  for (size_t k = 0; k < count; k++) {
+    if (rings.empty() || rings.back().ring != entries[k].ring) {
+      // a sphere touching one in the ring is at least this far from the
+      // axis, and within this distance of it
+      double distance = 2.0 * largest;
+      double inner = entries[k].ring * ringWidth - distance;
+      double u = inner > 0.0 ? distance / (2.0 * inner) : 1.0;
+      // asin(u) < 1.002 u below 0.1
+      double angle = u < 0.1 ? 2.004 * u : u < 1.0 ? 2.0 * asin(u) : HALF_TURN;
+
+      Ring ring = {entries[k].ring, (uint32_t)k, (uint32_t)k,
+                   std::min(angle, HALF_TURN) + ANGLE_SLACK};
+      rings.push_back(ring);
+    }
+    rings.back().end = (uint32_t)k + 1;
+    ringOf[k] = (uint32_t)rings.size() - 1;
+  }
+}
+
+void Broadphase::sweep(const double *x, const double *y, const double *z,
+                       const float *radius, ThreadPool &pool) {
+  size_t count = entries.size();
+  sx.resize(count);
+  sy.resize(count);
+  sz.resize(count);
+  sr.resize(count);
+
+  // bodies in sorted order
+  pool.parallelFor(count, [&](size_t begin, size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      uint32_t i = entries[k].body;
+      sx[k] = x[i];
+      sy[k] = y[i];
+      sz[k] = z[i];
+      sr[k] = radius[i];
+    }
+  });
+
+  size_t blocks = pool.size() * 8;
+  found.resize(blocks);
+  blockTests.resize(blocks);
+  pool.parallelFor(
+      blocks,
+      [&](size_t first, size_t past) {
+        const Entry *sorted = &entries[0];
+        for (size_t b = first; b < past; b++) {
+          std::vector<Contact> &pairs = found[b];
+          pairs.clear();
+          size_t tested = 0;
+
+          auto test = [&](size_t k, size_t j) {
+            tested++;
+            double dx = sx[j] - sx[k], dy = sy[j] - sy[k], dz = sz[j] - sz[k];
+            double touch = sr[j] + sr[k];
+            if (dx * dx + dy * dy + dz * dz > touch * touch)
+              return;
+            Contact contact = {std::min(sorted[k].body, sorted[j].body),
+                               std::max(sorted[k].body, sorted[j].body)};
+            pairs.push_back(contact);
+          };
+          // bodies of a ring with an angle in [low, high]
+          auto scan = [&](size_t k, const Ring &ring, double low,
+                          double high) {
+            const Entry *j = std::lower_bound(
+                sorted + ring.begin, sorted + ring.end, low,
+                [](const Entry &entry, double angle) {
+                  return entry.angle < angle;
+                });
+            for (; j < sorted + ring.end && j->angle <= high; j++)
+              test(k, j - sorted);
+          };
+
+          // where the previous body's look into the next ring started,
+          // bodies come in angle order so it only moves a little
+          const Entry *cursor = NULL;
+          uint32_t cursorRing = 0;
+
+          size_t end = count * (b + 1) / blocks;
+          for (size_t k = count * b / blocks; k < end; k++) {
+            // ahead in its own ring, past the end of the ring the order
+            // starts again one turn later. Further than half a turn it is
+            // the other body's turn to look
+            const Ring &own = rings[ringOf[k]];
+            double angle = sorted[k].angle;
+            double limit = angle + own.reach;
+            double turn = 0.0;
+            size_t j = k;
+            for (;;) {
+              if (++j == own.end) {
+                j = own.begin;
+                turn = TURN;
+              }
+              if (j == k || sorted[j].angle + turn > limit)
+                break;
+              test(k, j);
+            }
+
+            // both ways in the next ring out
+            uint32_t next = ringOf[k] + 1;
+            if (next == rings.size() || rings[next].ring != own.ring + 1)
+              continue;
+            const Ring &out = rings[next];
+            double low = angle - own.reach, high = angle + own.reach;
+            if (own.reach >= HALF_TURN) {
+              for (size_t j = out.begin; j < out.end; j++)
+                test(k, j);
+              continue;
+            }
+
+            if (cursor == NULL || cursorRing != next) {
+              cursor = std::lower_bound(sorted + out.begin,
+                                        sorted + out.end, low,
+                                        [](const Entry &entry, double a) {
+                                          return entry.angle < a;
+                                        });
+              cursorRing = next;
+            }
+            while (cursor > sorted + out.begin && (cursor - 1)->angle >= low)
+              cursor--;
+            while (cursor < sorted + out.end && cursor->angle < low)
+              cursor++;
+            for (const Entry *j = cursor;
+                 j < sorted + out.end && j->angle <= high; j++)
+              test(k, j - sorted);
+
+            // and across the seam
+            if (low < -HALF_TURN)
+              scan(k, out, low + TURN, HALF_TURN);
+            if (high > HALF_TURN)
+              scan(k, out, -HALF_TURN, high - TURN);
+          }
+          blockTests[b] = tested;
+        }
+      },
+      1);
+
+  contacts.clear();
+  tests = 0;
+  for (size_t b = 0; b < blocks; b++) {
+    contacts.insert(contacts.end(), found[b].begin(), found[b].end());
+    tests += blockTests[b];
+  }
+}
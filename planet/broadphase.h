@@ -0,0 +1,92 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "parallel.h"
+
+// Two bodies whose spheres overlap, a < b
+struct Contact {
+  uint32_t a, b;
+};
+
+// Finds overlapping spheres in a belt of bodies going round the z axis, by
+// sort and sweep along the orbital angle.
+//
+// The plane is cut into rings at least as wide as the largest sphere is
+// across, so two spheres that touch are in the same ring or in neighbouring
+// ones. Bodies are kept sorted by ring, then by their angle around the z
+// axis. Between two steps a belt only shears a little, so the previous order
+// is nearly right and update() repairs it with insertion sorts: one per block
+// of the order in parallel, then one over the whole order for what crossed a
+// block boundary. Bodies that changed ring or crossed the angle seam at +-pi
+// are taken out and merged back instead.
+//
+// The sweep then looks, in parallel for every body, at the bodies of its own
+// ring just ahead of it and of the next ring on both sides, as far in angle
+// as a sphere can be and still touch it, and tests those with a sphere sphere
+// test.
+class Broadphase {
+public:
+  // overlapping pairs found by the latest update()
+  std::vector<Contact> contacts;
+  // sphere tests done by the latest update()
+  size_t tests;
+
+  // timings of the latest update(), in seconds
+  double sortSeconds;
+  double sweepSeconds;
+
+  Broadphase()
+      : tests(0), sortSeconds(0), sweepSeconds(0), ringWidth(0) {}
+
+  // finds the overlapping pairs of count bodies with centres (x, y, z) and
+  // radius, all in the same unit
+  void update(const double *x, const double *y, const double *z,
+              const float *radius, size_t count, ThreadPool &pool);
+
+  // forgets the order, the next update() sorts from scratch
+  void reset() { entries.clear(); }
+
+private:
+  struct Entry {
+    int32_t ring;
+    uint32_t body;
+    double angle;
+
+    bool operator<(const Entry &other) const {
+      return ring < other.ring || (ring == other.ring && angle < other.angle);
+    }
+  };
+
+  // bodies [begin, end) of the order are in ring, and a sphere that touches
+  // one of them is at most reach ahead or behind in angle
+  struct Ring {
+    int32_t ring;
+    uint32_t begin, end;
+    double reach;
+  };
+
+  void sort(const double *x, const double *y, const float *radius,
+            size_t count, ThreadPool &pool);
+  void sweep(const double *x, const double *y, const double *z,
+             const float *radius, ThreadPool &pool);
+
+  // width of the rings, twice the largest radius of the latest sort
+  double ringWidth;
+  // bodies in ring and angle order
+  std::vector<Entry> entries, kept, crossed;
+  std::vector<uint8_t> moved;
+  std::vector<Ring> rings;
+  // ring of every entry, an index into rings
+  std::vector<uint32_t> ringOf;
+  // positions and radii in sorted order
+  std::vector<double> sx, sy, sz, sr;
+  // contacts found by each block of the sweep
+  std::vector<std::vector<Contact>> found;
+  std::vector<size_t> blockTests;
+};
+
+#endif
@@ -102,6 +102,13 @@ public:
     updateCameraVectors();
   }
 
+  // points the camera, for replays
+  void SetOrientation(float yaw, float pitch) {
+    Yaw = yaw;
+    Pitch = pitch;
+    updateCameraVectors();
+  }
+
   // processes input received from a mouse scroll-wheel event. Only requires
   // input on the vertical wheel-axis
   void ProcessMouseScroll(float yoffset) {
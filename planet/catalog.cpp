@@ -0,0 +1,522 @@
+#include "catalog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "bodies.h"
+
+int BodyCatalog::find(const std::string &name) const {
+  for (size_t k = 0; k < size(); k++)
+    if (this->name[k] == name)
+      return (int)k;
+  return -1;
+}
+
+void BodyCatalog::addOrbits(OrbitalElements &elements) const {
+  for (size_t k = 0; k < size(); k++)
+    addPlanet(elements, a[k], speed[k], e[k], inc[k], node[k], peri[k]);
+}
+
+// Just enough JSON for the catalog: the whole document is read into a tree of
+// values and the catalog is filled from that
+struct JsonValue {
+  enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+  Type type;
+  double number;
+  std::string string;
+  std::vector<JsonValue> items;
+  std::vector<std::string> keys; // object members are keys[i], items[i]
+
+  JsonValue() : type(NUL), number(0.0) {}
+
+  const JsonValue *get(const char *key) const {
+    for (size_t i = 0; i < keys.size(); i++)
+      if (keys[i] == key)
+        return &items[i];
+    return NULL;
+  }
+};
+
+class JsonParser {
+public:
+  std::string error;
+
+  JsonParser(const std::string &text)
+      : begin(text.c_str()), p(text.c_str()), end(text.c_str() + text.size()) {
+  }
+
+  bool parse(JsonValue &value) {
+    if (!parseValue(value, 0))
+      return false;
+    skipSpace();
+    return p == end || fail("trailing characters");
+  }
+
+private:
+  const char *begin, *p, *end;
+
+  bool fail(const char *what) {
+    int line = 1;
+    for (const char *c = begin; c < p; c++)
+      if (*c == '\n')
+        line++;
+    error = std::string(what) + " on line " + std::to_string(line);
+    return false;
+  }
+
+  void skipSpace() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+      p++;
+  }
+
+  bool literal(const char *word) {
+    size_t length = strlen(word);
+    if ((size_t)(end - p) < length || strncmp(p, word, length) != 0)
+      return false;
+    p += length;
+    return true;
+  }
+
+  bool parseValue(JsonValue &value, int depth) {
+    if (depth > 64)
+      return fail("nesting too deep");
+    skipSpace();
+    if (p == end)
+      return fail("unexpected end of file");
+
+    if (*p == '{')
+      return parseObject(value, depth);
+    if (*p == '[')
+      return parseArray(value, depth);
+    if (*p == '"') {
+      value.type = JsonValue::STRING;
+      return parseString(value.string);
+    }
+    if (literal("true") || literal("false")) {
+      value.type = JsonValue::BOOLEAN;
+      value.number = p[-1] == 'e' && p[-2] == 'u' ? 1.0 : 0.0;
+      return true;
+    }
+    if (literal("null")) {
+      value.type = JsonValue::NUL;
+      return true;
+    }
+
+    char *stop;
+    value.number = strtod(p, &stop);
+    if (stop == p)
+      return fail("unexpected character");
+    value.type = JsonValue::NUMBER;
+    p = stop;
+    return true;
+  }
+
+  bool parseObject(JsonValue &value, int depth) {
+    value.type = JsonValue::OBJECT;
+    p++;
+    skipSpace();
+    if (p < end && *p == '}') {
+      p++;
+      return true;
+    }
+    for (;;) {
+      skipSpace();
+      value.keys.push_back(std::string());
+      if (p == end || *p != '"' || !parseString(value.keys.back()))
+        return fail("expected a key");
+      skipSpace();
+      if (p == end || *p++ != ':')
+        return fail("expected ':'");
+      value.items.push_back(JsonValue());
+      if (!parseValue(value.items.back(), depth + 1))
+        return false;
+      skipSpace();
+      if (p < end && *p == ',') {
+        p++;
+        continue;
+      }
+      if (p < end && *p == '}') {
+        p++;
+        return true;
+      }
+      return fail("expected ',' or '}'");
+    }
+  }
+
+  bool parseArray(JsonValue &value, int depth) {
+    value.type = JsonValue::ARRAY;
+    p++;
+    skipSpace();
+    if (p < end && *p == ']') {
+      p++;
+      return true;
+    }
+    for (;;) {
+      value.items.push_back(JsonValue());
+      if (!parseValue(value.items.back(), depth + 1))
+        return false;
+      skipSpace();
+      if (p < end && *p == ',') {
+        p++;
+        continue;
+      }
+      if (p < end && *p == ']') {
+        p++;
+        return true;
+      }
+      return fail("expected ',' or ']'");
+    }
+  }
+
+  // strings are UTF-8 and stay that way, \u escapes are encoded back to it
+  bool parseString(std::string &out) {
+    p++;
+    out.clear();
+    while (p < end && *p != '"') {
+      if (*p != '\\') {
+        out += *p++;
+        continue;
+      }
+      if (++p == end)
+        break;
+      char c = *p++;
+      switch (c) {
+      case 'n':
+        out += '\n';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'u': {
+        if (end - p < 4)
+          return fail("bad \\u escape");
+        unsigned int code = (unsigned int)strtoul(std::string(p, 4).c_str(),
+                                                  NULL, 16);
+        p += 4;
+        if (code < 0x80) {
+          out += (char)code;
+        } else if (code < 0x800) {
+          out += (char)(0xc0 | code >> 6);
+          out += (char)(0x80 | (code & 0x3f));
+        } else {
+          out += (char)(0xe0 | code >> 12);
+          out += (char)(0x80 | (code >> 6 & 0x3f));
+          out += (char)(0x80 | (code & 0x3f));
+        }
+        break;
+      }
+      default:
+        out += c;
+      }
+    }
+    if (p == end)
+      return fail("unterminated string");
+    p++;
+    return true;
+  }
+};
+
+static double number(const JsonValue &object, const char *key,
+                     double fallback) {
+  const JsonValue *value = object.get(key);
+  return value != NULL && value->type == JsonValue::NUMBER ? value->number
+                                                           : fallback;
+}
+
+static std::string text(const JsonValue &object, const char *key) {
+  const JsonValue *value = object.get(key);
+  return value != NULL && value->type == JsonValue::STRING ? value->string
+                                                           : std::string();
+}
+
+static bool fromJson(BodyCatalog &catalog, const JsonValue &root,
+                     std::string &error) {
+  const JsonValue *bodies = root.get("bodies");
+  if (bodies == NULL || bodies->type != JsonValue::ARRAY) {
+    error = "no \"bodies\" array";
+    return false;
+  }
+
+  for (size_t k = 0; k < bodies->items.size(); k++) {
+    const JsonValue &body = bodies->items[k];
+    const JsonValue *orbit = body.get("orbit");
+    std::string name = text(body, "name");
+    if (name.empty() || text(body, "model").empty() || orbit == NULL) {
+      error = "body " + std::to_string(k) + " needs a name, model and orbit";
+      return false;
+    }
+
+    catalog.name.push_back(name);
+    catalog.model.push_back(text(body, "model"));
+    catalog.nightTexture.push_back(text(body, "nightTexture"));
+    catalog.cloudTexture.push_back(text(body, "cloudTexture"));
+    catalog.a.push_back(number(*orbit, "a", 1.0));
+    catalog.speed.push_back(number(*orbit, "speed", 0.0));
+    catalog.e.push_back(number(*orbit, "e", 0.0));
+    catalog.inc.push_back(number(*orbit, "inc", 0.0));
+    catalog.node.push_back(number(*orbit, "node", 0.0));
+    catalog.peri.push_back(number(*orbit, "peri", 0.0));
+    catalog.massRatio.push_back(number(body, "massRatio", 0.0));
+    catalog.scale.push_back((float)number(body, "scale", 1.0));
+    catalog.spin.push_back((float)number(body, "spin", 0.0));
+    catalog.yaw.push_back((float)number(body, "yaw", 0.0));
+    catalog.radius.push_back((float)number(body, "radius", 1.0));
+    catalog.flareCorrection.push_back(
+        (float)number(body, "flareCorrection", 1.0));
+    catalog.cameraOffset.push_back((float)number(body, "cameraOffset", 2.5));
+
+    JsonValue none;
+    const JsonValue *info = body.get("info");
+    if (info == NULL)
+      info = &none;
+    catalog.mass.push_back(text(*info, "mass"));
+    catalog.volume.push_back(text(*info, "volume"));
+    catalog.surfaceArea.push_back(text(*info, "surfaceArea"));
+    catalog.gravity.push_back(text(*info, "gravity"));
+    catalog.distanceToSun.push_back(text(*info, "distanceToSun"));
+    catalog.day.push_back(text(*info, "day"));
+    catalog.year.push_back(text(*info, "year"));
+
+    if (catalog.atmosphere.empty())
+      catalog.atmosphere.push_back(0);
+    const JsonValue *atmosphere = info->get("atmosphere");
+    if (atmosphere != NULL) {
+      for (size_t i = 0; i < atmosphere->items.size(); i++) {
+        const JsonValue &component = atmosphere->items[i];
+        if (component.items.size() != 2) {
+          error = name + " has an atmosphere entry that is not [gas, percent]";
+          return false;
+        }
+        catalog.gas.push_back(component.items[0].string);
+        catalog.gasFraction.push_back(component.items[1].string);
+      }
+    }
+    catalog.atmosphere.push_back((uint32_t)catalog.gas.size());
+
+    const JsonValue *moons = body.get("moons");
+    for (size_t m = 0; moons != NULL && m < moons->items.size(); m++) {
+      const JsonValue &moon = moons->items[m];
+      if (text(moon, "model").empty()) {
+        error = name + " has a moon without a model";
+        return false;
+      }
+      catalog.moonName.push_back(text(moon, "name"));
+      catalog.moonModel.push_back(text(moon, "model"));
+      catalog.moonParent.push_back((uint32_t)k);
+      catalog.moonDistance.push_back((float)number(moon, "distance", 10.0));
+      catalog.moonPeriod.push_back((float)number(moon, "period", 1.0));
+      catalog.moonSize.push_back((float)number(moon, "size", 1.0));
+      catalog.moonPhase.push_back((float)number(moon, "phase", 0.0));
+    }
+  }
+  return true;
+}
+
+// The binary cache is every column of the table in a fixed order, each one a
+// count followed by the values (or by length prefixed strings). visit() lists
+// the columns once for both directions
+struct CacheWriter {
+  std::string data;
+
+  void raw(const void *bytes, size_t length) {
+    data.append((const char *)bytes, length);
+  }
+  template <class T> void column(std::vector<T> &values) {
+    uint32_t count = (uint32_t)values.size();
+    raw(&count, sizeof(count));
+    if (count > 0)
+      raw(&values[0], count * sizeof(T));
+  }
+  void column(std::vector<std::string> &values) {
+    uint32_t count = (uint32_t)values.size();
+    raw(&count, sizeof(count));
+    for (size_t i = 0; i < values.size(); i++) {
+      uint32_t length = (uint32_t)values[i].size();
+      raw(&length, sizeof(length));
+      raw(values[i].data(), length);
+    }
+  }
+};
+
+struct CacheReader {
+  const char *p, *end;
+  bool ok;
+
+  CacheReader(const std::string &data)
+      : p(data.data()), end(data.data() + data.size()), ok(true) {}
+
+  bool raw(void *bytes, size_t length) {
+    if (!ok || (size_t)(end - p) < length)
+      return ok = false;
+    memcpy(bytes, p, length);
+    p += length;
+    return true;
+  }
+  template <class T> void column(std::vector<T> &values) {
+    uint32_t count = 0;
+    if (!raw(&count, sizeof(count)) ||
+        (size_t)(end - p) / sizeof(T) < count) {
+      ok = false;
+      return;
+    }
+    values.resize(count);
+    if (count > 0)
+      raw(&values[0], count * sizeof(T));
+  }
+  void column(std::vector<std::string> &values) {
+    uint32_t count = 0;
+    if (!raw(&count, sizeof(count)) || (size_t)(end - p) / 4 < count) {
+      ok = false;
+      return;
+    }
+    values.resize(count);
+    for (size_t i = 0; i < count && ok; i++) {
+      uint32_t length = 0;
+      if (raw(&length, sizeof(length)) && (size_t)(end - p) >= length) {
+        values[i].assign(p, length);
+        p += length;
+      } else {
+        ok = false;
+      }
+    }
+  }
+};
+
+template <class Archive> static void visit(Archive &ar, BodyCatalog &c) {
+  ar.column(c.name);
+  ar.column(c.model);
+  ar.column(c.nightTexture);
+  ar.column(c.cloudTexture);
+  ar.column(c.a);
+  ar.column(c.speed);
+  ar.column(c.e);
+  ar.column(c.inc);
+  ar.column(c.node);
+  ar.column(c.peri);
+  ar.column(c.massRatio);
+  ar.column(c.scale);
+  ar.column(c.spin);
+  ar.column(c.yaw);
+  ar.column(c.radius);
+  ar.column(c.flareCorrection);
+  ar.column(c.cameraOffset);
+  ar.column(c.mass);
+  ar.column(c.volume);
+  ar.column(c.surfaceArea);
+  ar.column(c.gravity);
+  ar.column(c.distanceToSun);
+  ar.column(c.day);
+  ar.column(c.year);
+  ar.column(c.atmosphere);
+  ar.column(c.gas);
+  ar.column(c.gasFraction);
+  ar.column(c.moonName);
+  ar.column(c.moonModel);
+  ar.column(c.moonParent);
+  ar.column(c.moonDistance);
+  ar.column(c.moonPeriod);
+  ar.column(c.moonSize);
+  ar.column(c.moonPhase);
+}
+
+static const char CACHE_MAGIC[4] = {'S', 'C', 'A', 'T'};
+static const uint32_t CACHE_VERSION = 1;
+
+static bool readFile(const char *path, std::string &data) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+  char buffer[65536];
+  size_t count;
+  data.clear();
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    data.append(buffer, count);
+  fclose(file);
+  return true;
+}
+
+static uint64_t fnv1a(const std::string &data) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < data.size(); i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// a catalog the cache holds for a source file with the given hash
+static bool readCache(BodyCatalog &catalog, const char *cachePath,
+                      uint64_t source) {
+  std::string data;
+  if (!readFile(cachePath, data))
+    return false;
+
+  CacheReader reader(data);
+  char magic[4];
+  uint32_t version = 0;
+  uint64_t hash = 0;
+  reader.raw(magic, 4);
+  reader.raw(&version, sizeof(version));
+  reader.raw(&hash, sizeof(hash));
+  if (!reader.ok || memcmp(magic, CACHE_MAGIC, 4) != 0 ||
+      version != CACHE_VERSION || hash != source)
+    return false;
+
+  visit(reader, catalog);
+  return reader.ok && reader.p == reader.end;
+}
+
+static void writeCache(BodyCatalog &catalog, const char *cachePath,
+                       uint64_t source) {
+  CacheWriter writer;
+  writer.raw(CACHE_MAGIC, 4);
+  writer.raw(&CACHE_VERSION, sizeof(CACHE_VERSION));
+  writer.raw(&source, sizeof(source));
+  visit(writer, catalog);
+
+  FILE *file = fopen(cachePath, "wb");
+  if (file == NULL)
+    return;
+  fwrite(writer.data.data(), 1, writer.data.size(), file);
+  fclose(file);
+}
+
+bool loadCatalog(BodyCatalog &catalog, const char *path,
+                 const char *cachePath) {
+  catalog = BodyCatalog();
+
+  std::string text;
+  if (!readFile(path, text)) {
+    std::cout << "ERROR::CATALOG::Could not read " << path << std::endl;
+    return false;
+  }
+  uint64_t source = fnv1a(text);
+  if (readCache(catalog, cachePath, source))
+    return true;
+  catalog = BodyCatalog();
+
+  JsonValue root;
+  JsonParser parser(text);
+  std::string error;
+  if (!parser.parse(root)) {
+    error = parser.error;
+  } else if (fromJson(catalog, root, error)) {
+    writeCache(catalog, cachePath, source);
+    return true;
+  }
+
+  std::cout << "ERROR::CATALOG::" << path << ": " << error << std::endl;
+  return false;
+}
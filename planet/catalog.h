@@ -0,0 +1,64 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kepler.h"
+
+// The bodies of the scene, read from a JSON catalog (resources/bodies.json)
+// into one array per field. Planets are drawn, followed by the camera and
+// listed in the menus in catalog order; moons refer to their planet by index.
+struct BodyCatalog {
+  // planets
+  std::vector<std::string> name;
+  std::vector<std::string> model;
+  // Earth style night lights and clouds, empty when the planet has none
+  std::vector<std::string> nightTexture, cloudTexture;
+  // orbit size (AU), mean motion (1e-4 degrees per tick), eccentricity and
+  // inclination, ascending node and periapsis (degrees)
+  std::vector<double> a, speed, e, inc, node, peri;
+  // mass relative to the Sun
+  std::vector<double> massRatio;
+  // model scale, spin speed and yaw at t = 0
+  std::vector<float> scale, spin, yaw;
+  // radius of the sphere that hides the Sun from the lens flare, and how fast
+  // it shrinks with distance
+  std::vector<float> radius, flareCorrection;
+  // how far the camera sits when following the planet
+  std::vector<float> cameraOffset;
+
+  // info panel
+  std::vector<std::string> mass, volume, surfaceArea, gravity, distanceToSun,
+      day, year;
+  // atmosphere of planet k is [atmosphere[k], atmosphere[k + 1]) of gas and
+  // gasFraction (percent)
+  std::vector<uint32_t> atmosphere;
+  std::vector<std::string> gas, gasFraction;
+
+  // moons, circling their parent planet at distance (scene units) once per
+  // period (Earth days), phase is the angle at t = 0 (radians) and size the
+  // scale relative to the Moon
+  std::vector<std::string> moonName, moonModel;
+  std::vector<uint32_t> moonParent;
+  std::vector<float> moonDistance, moonPeriod, moonSize, moonPhase;
+
+  size_t size() const { return name.size(); }
+  size_t moonCount() const { return moonName.size(); }
+
+  // index of the planet called name, -1 if there is none
+  int find(const std::string &name) const;
+
+  // appends the orbits of every planet, indexed like the catalog
+  void addOrbits(OrbitalElements &elements) const;
+};
+
+// Reads the catalog at path. The parsed table is cached at cachePath and read
+// back from there as long as the catalog file does not change. Prints what is
+// wrong and returns false if the file cannot be read or parsed
+bool loadCatalog(BodyCatalog &catalog, const char *path,
+                 const char *cachePath);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <cmath>
+
+// Fixed timestep simulation clock. Real (wall clock) time is fed in through
+// accumulate() and consumed in steps of constant simulation time by tick(), so
+// the simulation advances at the same rate no matter how fast frames are
+// rendered, and can run faster than real time when nothing is rendered at all.
+//
+// Rendering happens between two completed steps, so it runs one step behind
+// the simulation: alpha() tells how far the leftover accumulated time is into
+// the next step, and renderTime() is the matching point between the previous
+// and the current step. State that is a closed form function of time is
+// evaluated at renderTime(); integrated state keeps its previous and current
+// values and is blended with alpha().
+class SimClock {
+public:
+  // simulation time of the latest completed step
+  double time;
+  // simulation time of the step before that
+  double previous;
+  // length of one fixed step, in simulation time units
+  double step;
+  // simulation time units per real second
+  double rate;
+  // steps allowed per accumulate() call, 0 for unbounded. Keeps a slow frame
+  // from requesting ever more steps (the "spiral of death")
+  int maxSteps;
+
+  SimClock(double step = 1.0, double rate = 60.0, int maxSteps = 2048)
+      : time(0.0), previous(-step), step(step), rate(rate), maxSteps(maxSteps),
+        accumulator(0.0), pending(0) {}
+
+  // adds real elapsed seconds to the clock
+  void accumulate(double realDelta) {
+    if (realDelta < 0.0)
+      realDelta = 0.0;
+    accumulator += realDelta * rate;
+    pending = 0;
+  }
+
+  // consumes one fixed step if enough time has accumulated. Call in a loop and
+  // update the simulation once per true return
+  bool tick() {
+    if (accumulator < step)
+      return false;
+
+    if (maxSteps > 0 && pending >= maxSteps) {
+      // drop what we could not simulate this frame, keep the fraction so
+      // alpha() stays meaningful
+      accumulator = std::fmod(accumulator, step);
+      return false;
+    }
+
+    accumulator -= step;
+    previous = time;
+    time += step;
+    pending++;
+    return true;
+  }
+
+  // fraction of a step accumulated past the latest completed step, in [0, 1)
+  double alpha() const { return step > 0.0 ? accumulator / step : 0.0; }
+
+  // point in simulation time the current frame should show
+  double renderTime() const { return previous + (time - previous) * alpha(); }
+
+  // steps taken since the last accumulate()
+  int stepsThisFrame() const { return pending; }
+
+  void reset(double t = 0.0) {
+    time = t;
+    previous = t - step;
+    accumulator = 0.0;
+    pending = 0;
+  }
+
+private:
+  double accumulator;
+  int pending;
+};
+#endif
@@ -0,0 +1,188 @@
+#include "ephemeris.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const uint32_t EPHEMERIS_VERSION = 1;
+
+bool Ephemeris::open(const char *path, uint64_t source) {
+  close();
+  if (!map.open(path))
+    return false;
+  const void *data = map.data();
+  size_t length = map.size();
+
+  // check everything the lookups rely on before trusting the file
+  const EphemerisHeader *h = (const EphemerisHeader *)data;
+  if (length < sizeof(EphemerisHeader) || memcmp(h->magic, "SEPH", 4) != 0 ||
+      h->version != EPHEMERIS_VERSION || h->coefficients == 0 ||
+      (source != 0 && h->source != source) || !(h->end >= h->start)) {
+    close();
+    return false;
+  }
+  size_t tableStart =
+      sizeof(EphemerisHeader) + h->bodies * sizeof(EphemerisBody);
+  if (length < tableStart) {
+    close();
+    return false;
+  }
+  const EphemerisBody *b =
+      (const EphemerisBody *)((const char *)data + sizeof(EphemerisHeader));
+  size_t doubles = (length - tableStart) / sizeof(double);
+  for (uint32_t k = 0; k < h->bodies; k++) {
+    if (b[k].segments == 0 || !(b[k].span > 0.0) ||
+        b[k].offset + b[k].segments * 3 * h->coefficients > doubles) {
+      close();
+      return false;
+    }
+  }
+
+  header = h;
+  body = b;
+  table = (const double *)((const char *)data + tableStart);
+  return true;
+}
+
+void Ephemeris::close() {
+  map.close();
+  header = NULL;
+  body = NULL;
+  table = NULL;
+}
+
+// sum of c[k] T_k(tau) by Clenshaw's recurrence
+static double chebyshev(const double *c, unsigned int count, double tau) {
+  double b1 = 0.0, b2 = 0.0;
+  for (unsigned int k = count - 1; k > 0; k--) {
+    double b = 2.0 * tau * b1 - b2 + c[k];
+    b2 = b1;
+    b1 = b;
+  }
+  return tau * b1 - b2 + c[0];
+}
+
+void Ephemeris::position(size_t index, double t, double pos[3]) const {
+  const EphemerisBody &b = body[index];
+  unsigned int count = header->coefficients;
+
+  double u = (t - header->start) / b.span;
+  uint64_t segment = u > 0.0 ? (uint64_t)u : 0;
+  if (segment >= b.segments)
+    segment = b.segments - 1;
+  // time within the segment, mapped to [-1, 1]
+  double tau = 2.0 * (u - (double)segment) - 1.0;
+
+  const double *c = table + b.offset + segment * 3 * count;
+  pos[0] = chebyshev(c, count, tau);
+  pos[1] = chebyshev(c + count, count, tau);
+  pos[2] = chebyshev(c + 2 * count, count, tau);
+}
+
+void Ephemeris::positions(double t, float *x, float *y, float *z) const {
+  for (size_t k = 0; k < header->bodies; k++) {
+    double pos[3];
+    position(k, t, pos);
+    x[k] = (float)pos[0];
+    y[k] = (float)pos[1];
+    z[k] = (float)pos[2];
+  }
+}
+
+bool writeEphemeris(
+    const char *path, size_t count, const double *spans, double start,
+    double end, unsigned int coefficients, uint64_t source,
+    const std::function<void(size_t body, double t, double pos[3])> &position) {
+  if (coefficients == 0 || !(end >= start))
+    return false;
+
+  EphemerisHeader header;
+  memcpy(header.magic, "SEPH", 4);
+  header.version = EPHEMERIS_VERSION;
+  header.bodies = (uint32_t)count;
+  header.coefficients = coefficients;
+  header.source = source;
+  header.start = start;
+  header.end = end;
+
+  std::vector<EphemerisBody> bodies(count);
+  uint64_t offset = 0;
+  for (size_t k = 0; k < count; k++) {
+    bodies[k].span = spans[k];
+    bodies[k].segments = (uint64_t)ceil((end - start) / spans[k]);
+    if (bodies[k].segments == 0)
+      bodies[k].segments = 1;
+    bodies[k].offset = offset;
+    offset += bodies[k].segments * 3 * coefficients;
+  }
+
+  FILE *out = fopen(path, "wb");
+  if (out == NULL)
+    return false;
+  fwrite(&header, sizeof(header), 1, out);
+  fwrite(&bodies[0], sizeof(EphemerisBody), count, out);
+
+  // Chebyshev interpolation: sample at the nodes of T_coefficients and
+  // project onto each polynomial, which is near the best fit of that degree
+  std::vector<double> nodeCos(coefficients * coefficients);
+  for (unsigned int k = 0; k < coefficients; k++)
+    for (unsigned int j = 0; j < coefficients; j++)
+      nodeCos[k * coefficients + j] = cos(M_PI * k * (j + 0.5) / coefficients);
+
+  std::vector<double> samples(3 * coefficients);
+  std::vector<double> segment(3 * coefficients);
+  for (size_t k = 0; k < count; k++) {
+    for (uint64_t s = 0; s < bodies[k].segments; s++) {
+      double t0 = start + s * spans[k];
+      for (unsigned int j = 0; j < coefficients; j++) {
+        double tau = nodeCos[coefficients + j];
+        position(k, t0 + (tau + 1.0) * 0.5 * spans[k], &samples[3 * j]);
+      }
+      for (unsigned int axis = 0; axis < 3; axis++) {
+        for (unsigned int i = 0; i < coefficients; i++) {
+          double sum = 0.0;
+          for (unsigned int j = 0; j < coefficients; j++)
+            sum += samples[3 * j + axis] * nodeCos[i * coefficients + j];
+          segment[axis * coefficients + i] =
+              sum * (i == 0 ? 1.0 : 2.0) / coefficients;
+        }
+      }
+      fwrite(&segment[0], sizeof(double), segment.size(), out);
+    }
+  }
+  return fclose(out) == 0;
+}
+
+uint64_t ephemerisSource(const OrbitalElements &elements) {
+  // FNV-1a over every element of every body
+  uint64_t hash = 14695981039346656037ull;
+  const std::vector<double> *columns[] = {&elements.a,    &elements.e,
+                                          &elements.inc,  &elements.node,
+                                          &elements.peri, &elements.M0,
+                                          &elements.n};
+  for (size_t c = 0; c < 7; c++) {
+    const unsigned char *bytes = (const unsigned char *)columns[c]->data();
+    for (size_t i = 0; i < columns[c]->size() * sizeof(double); i++) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+  }
+  return hash;
+}
+
+bool writeEphemeris(const char *path, const OrbitalElements &elements,
+                    double start, double end, unsigned int segmentsPerOrbit,
+                    unsigned int coefficients) {
+  std::vector<double> spans(elements.size());
+  for (size_t k = 0; k < elements.size(); k++)
+    spans[k] = 2.0 * M_PI / elements.n[k] / segmentsPerOrbit;
+
+  // gm only shapes velocities, which are not tabulated
+  return writeEphemeris(path, elements.size(), spans.data(), start, end,
+                        coefficients, ephemerisSource(elements),
+                        [&](size_t body, double t, double pos[3]) {
+                          double vel[3];
+                          elementsToState(elements, body, t, 1.0, pos, vel);
+                        });
+}
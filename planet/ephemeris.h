@@ -0,0 +1,92 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "kepler.h"
+#include "mapped.h"
+
+// Precomputed body positions as Chebyshev polynomials, the way the JPL DE
+// files store them. Time is cut into segments of fixed length per body and
+// each segment holds one polynomial per axis, so a position at any time inside
+// the table costs a division to find the segment and a Clenshaw sum, whatever
+// the time is.
+//
+// The file is little endian and read in place through a memory map:
+//
+//   EphemerisHeader; EphemerisBody[bodies]; double coefficients[]
+//
+// A body's segments follow each other from its offset, each one being the x,
+// y and z coefficients one after the other. Positions are ecliptic, in AU.
+struct EphemerisHeader {
+  char magic[4]; // "SEPH"
+  uint32_t version;
+  uint32_t bodies;
+  uint32_t coefficients; // per axis and segment, polynomial degree + 1
+  uint64_t source;       // hash of what was fitted, to spot stale files
+  double start, end;     // time covered, in ticks
+};
+
+struct EphemerisBody {
+  double span;       // segment length, in ticks
+  uint64_t offset;   // first coefficient, in doubles from the table start
+  uint64_t segments; // segment count
+};
+
+class Ephemeris {
+public:
+  Ephemeris() : header(NULL), body(NULL), table(NULL) {}
+  ~Ephemeris() { close(); }
+
+  // maps a table, returns false if it is missing, malformed or fitted from
+  // something else than source (0 accepts any)
+  bool open(const char *path, uint64_t source = 0);
+  void close();
+  bool isOpen() const { return header != NULL; }
+
+  size_t bodies() const { return header ? header->bodies : 0; }
+  double start() const { return header ? header->start : 0.0; }
+  double end() const { return header ? header->end : 0.0; }
+  // size of the mapped file in bytes
+  size_t bytes() const { return map.size(); }
+
+  bool contains(double t) const {
+    return header != NULL && t >= header->start && t <= header->end;
+  }
+
+  // position of one body at t, which must be inside the table
+  void position(size_t index, double t, double pos[3]) const;
+  // positions of every body at t
+  void positions(double t, float *x, float *y, float *z) const;
+
+private:
+  Ephemeris(const Ephemeris &);
+  Ephemeris &operator=(const Ephemeris &);
+
+  MappedFile map;
+  const EphemerisHeader *header;
+  const EphemerisBody *body;
+  const double *table;
+};
+
+// Writes position(body, t, pos) for bodies [0, count) between start and end
+// as a table. Each body gets segments of spans[body] ticks, fitted with
+// coefficients terms per axis at the Chebyshev nodes
+bool writeEphemeris(
+    const char *path, size_t count, const double *spans, double start,
+    double end, unsigned int coefficients, uint64_t source,
+    const std::function<void(size_t body, double t, double pos[3])> &position);
+
+// Tabulates the Keplerian orbits of elements, with segmentsPerOrbit segments
+// for every revolution of a body
+bool writeEphemeris(const char *path, const OrbitalElements &elements,
+                    double start, double end,
+                    unsigned int segmentsPerOrbit = 8,
+                    unsigned int coefficients = 12);
+
+// The source hash writeEphemeris() stores for a set of elements
+uint64_t ephemerisSource(const OrbitalElements &elements);
+
+#endif
@@ -0,0 +1,146 @@
+#include "frustum.h"
+
+#include <cmath>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+Frustum::Frustum() {
+  for (int k = 0; k < 6; k++) {
+    planes[k][0] = planes[k][1] = planes[k][2] = 0.0f;
+    planes[k][3] = 1.0f;
+  }
+}
+
+Frustum::Frustum(const float matrix[16]) {
+  // row r of the matrix is matrix[r], matrix[4 + r], ...; the planes are the
+  // last row plus or minus each of the others: left, right, bottom, top,
+  // near, far
+  for (int k = 0; k < 6; k++) {
+    int row = k / 2;
+    float sign = k % 2 == 0 ? 1.0f : -1.0f;
+    for (int c = 0; c < 4; c++)
+      planes[k][c] = matrix[4 * c + 3] + sign * matrix[4 * c + row];
+    float length = sqrtf(planes[k][0] * planes[k][0] +
+                         planes[k][1] * planes[k][1] +
+                         planes[k][2] * planes[k][2]);
+    if (length > 0.0f)
+      for (int c = 0; c < 4; c++)
+        planes[k][c] /= length;
+  }
+}
+
+bool Frustum::contains(float x, float y, float z, float radius) const {
+  for (int k = 0; k < 6; k++) {
+    const float *p = planes[k];
+    // summed in the order the vector kernels do
+    if ((p[0] * x + p[1] * y) + (p[2] * z + (p[3] + radius)) < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+// Scalar reference, also handles the tail that does not fill a SIMD register
+static size_t cullScalar(const Frustum &frustum, const float *x,
+                         const float *y, const float *z, const float *radius,
+                         size_t begin, size_t end, uint8_t *visible) {
+  size_t count = 0;
+  for (size_t i = begin; i < end; i++) {
+    visible[i] = frustum.contains(x[i], y[i], z[i], radius[i]) ? 1 : 0;
+    count += visible[i];
+  }
+  return count;
+}
+
+#if defined(__AVX__)
+
+struct CullOps {
+  typedef __m256 V;
+  static const int WIDTH = 8;
+  static V load(const float *p) { return _mm256_loadu_ps(p); }
+  static V set1(float f) { return _mm256_set1_ps(f); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V both(V a, V b) { return _mm256_and_ps(a, b); }
+  static V notNegative(V v) {
+    return _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GE_OQ);
+  }
+  static int bits(V mask) { return _mm256_movemask_ps(mask); }
+};
+
+#elif defined(__SSE2__)
+
+struct CullOps {
+  typedef __m128 V;
+  static const int WIDTH = 4;
+  static V load(const float *p) { return _mm_loadu_ps(p); }
+  static V set1(float f) { return _mm_set1_ps(f); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V both(V a, V b) { return _mm_and_ps(a, b); }
+  static V notNegative(V v) { return _mm_cmpge_ps(v, _mm_setzero_ps()); }
+  static int bits(V mask) { return _mm_movemask_ps(mask); }
+};
+
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__)
+
+// WIDTH spheres against one plane per step, all six planes before moving on
+template <class S>
+static size_t cullSimd(const Frustum &frustum, const float *x, const float *y,
+                       const float *z, const float *radius, size_t begin,
+                       size_t end, uint8_t *visible) {
+  typedef typename S::V V;
+  V a[6], b[6], c[6], d[6];
+  for (int k = 0; k < 6; k++) {
+    a[k] = S::set1(frustum.planes[k][0]);
+    b[k] = S::set1(frustum.planes[k][1]);
+    c[k] = S::set1(frustum.planes[k][2]);
+    d[k] = S::set1(frustum.planes[k][3]);
+  }
+
+  size_t count = 0;
+  size_t i = begin;
+  for (; i + S::WIDTH <= end; i += S::WIDTH) {
+    V px = S::load(x + i), py = S::load(y + i), pz = S::load(z + i);
+    V r = S::load(radius + i);
+    V inside = S::notNegative(
+        S::add(S::add(S::mul(a[0], px), S::mul(b[0], py)),
+               S::add(S::mul(c[0], pz), S::add(d[0], r))));
+    for (int k = 1; k < 6; k++)
+      inside = S::both(
+          inside, S::notNegative(
+                      S::add(S::add(S::mul(a[k], px), S::mul(b[k], py)),
+                             S::add(S::mul(c[k], pz), S::add(d[k], r)))));
+    int mask = S::bits(inside);
+    for (int l = 0; l < S::WIDTH; l++) {
+      visible[i + l] = (uint8_t)((mask >> l) & 1);
+      count += visible[i + l];
+    }
+  }
+  return count + cullScalar(frustum, x, y, z, radius, i, end, visible);
+}
+
+#endif
+
+size_t cullSpheres(const Frustum &frustum, const float *x, const float *y,
+                   const float *z, const float *radius, size_t begin,
+                   size_t end, uint8_t *visible) {
+#if defined(__AVX__) || defined(__SSE2__)
+  return cullSimd<CullOps>(frustum, x, y, z, radius, begin, end, visible);
+#else
+  return cullScalar(frustum, x, y, z, radius, begin, end, visible);
+#endif
+}
+
+const char *cullKernelName() {
+#if defined(__AVX__)
+  return "AVX";
+#elif defined(__SSE2__)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
@@ -0,0 +1,40 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The six planes of a view frustum, pointing inwards: a point p is inside
+// plane k when planes[k][0] p.x + planes[k][1] p.y + planes[k][2] p.z +
+// planes[k][3] >= 0. Planes are normalised, so that sum is a distance in the
+// units of the space the matrix they came from starts in.
+//
+// A default frustum holds everything.
+struct Frustum {
+  float planes[6][4];
+
+  Frustum();
+
+  // the planes of a projection * view (* model) matrix, column major like
+  // glm (Gribb and Hartmann, "Fast extraction of viewing frustum planes from
+  // the world-view-projection matrix", 2001). Spheres tested against it are
+  // in the space the matrix maps from
+  explicit Frustum(const float matrix[16]);
+
+  // whether any of the sphere is inside
+  bool contains(float x, float y, float z, float radius) const;
+};
+
+// Tests spheres [begin, end) against a frustum: visible[i] is set to 1 for
+// the ones at least partly inside and to 0 for the ones wholly outside some
+// plane. Returns how many are visible. Eight spheres at a time with AVX, four
+// with SSE2, one by one otherwise. Disjoint ranges may be culled from
+// different threads at the same time
+size_t cullSpheres(const Frustum &frustum, const float *x, const float *y,
+                   const float *z, const float *radius, size_t begin,
+                   size_t end, uint8_t *visible);
+
+// name of the kernel compiled in, for the UI and benchmarks
+const char *cullKernelName();
+
+#endif
@@ -0,0 +1,54 @@
+#include "gpucull.h"
+
+void GpuCuller::create(size_t capacity, size_t stride) {
+  release();
+  this->capacity = capacity;
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, capacity * stride, NULL, GL_DYNAMIC_COPY);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glGenQueries(1, &query);
+}
+
+void GpuCuller::release() {
+  if (query != 0)
+    glDeleteQueries(1, &query);
+  if (vbo != 0)
+    glDeleteBuffers(1, &vbo);
+  if (vao != 0)
+    glDeleteVertexArrays(1, &vao);
+  vao = vbo = query = 0;
+  pending = false;
+  kept = 0;
+}
+
+void GpuCuller::run(GLsizei count) {
+  if ((size_t)count > capacity)
+    count = (GLsizei)capacity;
+  glEnable(GL_RASTERIZER_DISCARD);
+  glBindVertexArray(vao);
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vbo);
+  glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query);
+  glBeginTransformFeedback(GL_POINTS);
+  glDrawArrays(GL_POINTS, 0, count);
+  glEndTransformFeedback();
+  glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+  glBindVertexArray(0);
+  glDisable(GL_RASTERIZER_DISCARD);
+  pending = true;
+}
+
+size_t GpuCuller::visible() {
+  if (pending) {
+    GLuint ready = 0, written = 0;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &ready);
+    if (!ready)
+      waits++;
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT, &written);
+    kept = written;
+    pending = false;
+  }
+  return kept;
+}
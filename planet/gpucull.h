@@ -0,0 +1,51 @@
+#ifndef GPUCULL_H
+#define GPUCULL_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+// Instances culled on the GPU with transform feedback, as GL 3.3 allows.
+//
+// run() draws the instances as points through a feedback program with the
+// rasterizer off. Its geometry shader emits the instances that pass and
+// drops the rest, so the survivors land packed at the start of buffer(),
+// ready to be read as instance attributes by the draw, and a primitives
+// written query counts them. GL 3.3 has no indirect draws, so that count
+// comes back to the CPU: the pass is run early in the frame and the result
+// asked for just before the draw, by which time the GPU is usually done.
+class GpuCuller {
+public:
+  // times visible() found the count not ready and waited for it
+  size_t waits;
+
+  GpuCuller()
+      : waits(0), vao(0), vbo(0), query(0), capacity(0), pending(false),
+        kept(0) {}
+
+  // room for capacity instances of stride bytes out
+  void create(size_t capacity, size_t stride);
+  void release();
+
+  // the vertex array run() draws, the caller points its attributes at the
+  // instances going in
+  GLuint vertexArray() const { return vao; }
+  // the instances that passed, packed
+  GLuint buffer() const { return vbo; }
+
+  // culls count instances with the feedback program in use
+  void run(GLsizei count);
+  // how many passed the last run()
+  size_t visible();
+
+private:
+  GpuCuller(const GpuCuller &);
+  GpuCuller &operator=(const GpuCuller &);
+
+  GLuint vao, vbo, query;
+  size_t capacity;
+  bool pending;
+  size_t kept;
+};
+
+#endif
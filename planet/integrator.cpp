@@ -0,0 +1,158 @@
+#include "integrator.h"
+
+#include <cmath>
+
+void BodyState::reserve(size_t count) {
+  x.reserve(count);
+  y.reserve(count);
+  z.reserve(count);
+  vx.reserve(count);
+  vy.reserve(count);
+  vz.reserve(count);
+  gm.reserve(count);
+}
+
+void BodyState::clear() {
+  x.clear();
+  y.clear();
+  z.clear();
+  vx.clear();
+  vy.clear();
+  vz.clear();
+  gm.clear();
+  accelerationsValid = false;
+}
+
+size_t BodyState::add(const double pos[3], const double vel[3], double gm) {
+  x.push_back(pos[0]);
+  y.push_back(pos[1]);
+  z.push_back(pos[2]);
+  vx.push_back(vel[0]);
+  vy.push_back(vel[1]);
+  vz.push_back(vel[2]);
+  this->gm.push_back(gm);
+  accelerationsValid = false;
+  return x.size() - 1;
+}
+
+static void computeAccelerations(BodyState &s) {
+  size_t count = s.size();
+  s.ax.assign(count, 0.0);
+  s.ay.assign(count, 0.0);
+  s.az.assign(count, 0.0);
+
+  // every pair once, Newton's third law gives the other half
+  for (size_t i = 0; i < count; i++) {
+    double xi = s.x[i], yi = s.y[i], zi = s.z[i];
+    double axi = 0.0, ayi = 0.0, azi = 0.0;
+    for (size_t j = i + 1; j < count; j++) {
+      double dx = s.x[j] - xi, dy = s.y[j] - yi, dz = s.z[j] - zi;
+      double r2 = dx * dx + dy * dy + dz * dz;
+      double inv3 = 1.0 / (r2 * sqrt(r2));
+      axi += dx * s.gm[j] * inv3;
+      ayi += dy * s.gm[j] * inv3;
+      azi += dz * s.gm[j] * inv3;
+      s.ax[j] -= dx * s.gm[i] * inv3;
+      s.ay[j] -= dy * s.gm[i] * inv3;
+      s.az[j] -= dz * s.gm[i] * inv3;
+    }
+    s.ax[i] += axi;
+    s.ay[i] += ayi;
+    s.az[i] += azi;
+  }
+  s.accelerationsValid = true;
+}
+
+static void drift(BodyState &s, double dt) {
+  for (size_t i = 0; i < s.size(); i++) {
+    s.x[i] += s.vx[i] * dt;
+    s.y[i] += s.vy[i] * dt;
+    s.z[i] += s.vz[i] * dt;
+  }
+  s.accelerationsValid = false;
+}
+
+static void kick(BodyState &s, double dt) {
+  for (size_t i = 0; i < s.size(); i++) {
+    s.vx[i] += s.ax[i] * dt;
+    s.vy[i] += s.ay[i] * dt;
+    s.vz[i] += s.az[i] * dt;
+  }
+}
+
+// kick-drift-kick, the closing acceleration is reused by the next step
+static void leapfrogStep(BodyState &s, double dt) {
+  if (!s.accelerationsValid)
+    computeAccelerations(s);
+  kick(s, dt * 0.5);
+  drift(s, dt);
+  computeAccelerations(s);
+  kick(s, dt * 0.5);
+}
+
+// Yoshida (1990) triple jump, three leapfrogs of weights w1, w0, w1
+static void yoshida4Step(BodyState &s, double dt) {
+  static const double CBRT2 = 1.2599210498948731647672;
+  static const double W1 = 1.0 / (2.0 - CBRT2);
+  static const double W0 = -CBRT2 * W1;
+  static const double C[4] = {W1 * 0.5, (W0 + W1) * 0.5, (W0 + W1) * 0.5,
+                              W1 * 0.5};
+  static const double D[3] = {W1, W0, W1};
+
+  for (int k = 0; k < 3; k++) {
+    drift(s, C[k] * dt);
+    computeAccelerations(s);
+    kick(s, D[k] * dt);
+  }
+  drift(s, C[3] * dt);
+}
+
+void integrate(BodyState &state, IntegratorType type, double dt) {
+  if (type == INTEGRATOR_YOSHIDA4)
+    yoshida4Step(state, dt);
+  else
+    leapfrogStep(state, dt);
+}
+
+double totalEnergy(const BodyState &s) {
+  double kinetic = 0.0, potential = 0.0;
+  for (size_t i = 0; i < s.size(); i++) {
+    double v2 = s.vx[i] * s.vx[i] + s.vy[i] * s.vy[i] + s.vz[i] * s.vz[i];
+    kinetic += 0.5 * s.gm[i] * v2;
+    for (size_t j = i + 1; j < s.size(); j++) {
+      double dx = s.x[j] - s.x[i], dy = s.y[j] - s.y[i], dz = s.z[j] - s.z[i];
+      potential -= s.gm[i] * s.gm[j] / sqrt(dx * dx + dy * dy + dz * dz);
+    }
+  }
+  return kinetic + potential;
+}
+
+void centreOfMassFrame(BodyState &s) {
+  double m = 0.0, cx = 0.0, cy = 0.0, cz = 0.0, cvx = 0.0, cvy = 0.0,
+         cvz = 0.0;
+  for (size_t i = 0; i < s.size(); i++) {
+    m += s.gm[i];
+    cx += s.gm[i] * s.x[i];
+    cy += s.gm[i] * s.y[i];
+    cz += s.gm[i] * s.z[i];
+    cvx += s.gm[i] * s.vx[i];
+    cvy += s.gm[i] * s.vy[i];
+    cvz += s.gm[i] * s.vz[i];
+  }
+  if (m <= 0.0)
+    return;
+
+  for (size_t i = 0; i < s.size(); i++) {
+    s.x[i] -= cx / m;
+    s.y[i] -= cy / m;
+    s.z[i] -= cz / m;
+    s.vx[i] -= cvx / m;
+    s.vy[i] -= cvy / m;
+    s.vz[i] -= cvz / m;
+  }
+  s.accelerationsValid = false;
+}
+
+const char *integratorName(IntegratorType type) {
+  return type == INTEGRATOR_YOSHIDA4 ? "yoshida4" : "leapfrog";
+}
@@ -0,0 +1,48 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <cstddef>
+#include <vector>
+
+// Symplectic integrators for a small set of mutually attracting bodies (the
+// Sun and the planets), in double precision. Forces are summed directly over
+// every pair, which is the right tool below a few hundred bodies; bigger sets
+// belong in NBody.
+//
+// Both integrators conserve energy to a bounded error instead of letting it
+// drift, as long as the step resolves the fastest orbit:
+//  - leapfrog (velocity Verlet), 2nd order, one force evaluation per step
+//  - Yoshida, 4th order, three force evaluations per step
+
+enum IntegratorType { INTEGRATOR_LEAPFROG, INTEGRATOR_YOSHIDA4 };
+
+// Bodies as one array per component. gm is the gravitational parameter G * m
+struct BodyState {
+  std::vector<double> x, y, z;
+  std::vector<double> vx, vy, vz;
+  std::vector<double> gm;
+  // accelerations at the current positions, valid after a leapfrog step
+  std::vector<double> ax, ay, az;
+  bool accelerationsValid;
+
+  BodyState() : accelerationsValid(false) {}
+
+  size_t size() const { return x.size(); }
+
+  void reserve(size_t count);
+  void clear();
+  size_t add(const double pos[3], const double vel[3], double gm);
+};
+
+// advances every body by dt
+void integrate(BodyState &state, IntegratorType type, double dt);
+
+// kinetic plus potential energy times G, relative drifts are unaffected
+double totalEnergy(const BodyState &state);
+
+// moves the system into its barycentric frame, so it does not drift away
+void centreOfMassFrame(BodyState &state);
+
+const char *integratorName(IntegratorType type);
+
+#endif
@@ -0,0 +1,430 @@
+#include "kepler.h"
+
+#include <cmath>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+static const double TWO_PI = 6.283185307179586476925;
+
+// Newton iterations are stopped once every lane is below this residual
+static const float KEPLER_TOLERANCE = 1e-6f;
+static const int KEPLER_MAX_ITERATIONS = 8;
+
+void OrbitalElements::reserve(size_t count) {
+  a.reserve(count);
+  e.reserve(count);
+  inc.reserve(count);
+  node.reserve(count);
+  peri.reserve(count);
+  M0.reserve(count);
+  n.reserve(count);
+}
+
+void OrbitalElements::clear() {
+  a.clear();
+  e.clear();
+  inc.clear();
+  node.clear();
+  peri.clear();
+  M0.clear();
+  n.clear();
+}
+
+size_t OrbitalElements::add(double a, double e, double inc, double node,
+                            double peri, double M0, double n) {
+  this->a.push_back(a);
+  this->e.push_back(e);
+  this->inc.push_back(inc);
+  this->node.push_back(node);
+  this->peri.push_back(peri);
+  this->M0.push_back(M0);
+  this->n.push_back(n);
+  return this->a.size() - 1;
+}
+
+void elementsToState(const OrbitalElements &elements, size_t body, double t,
+                     double gm, double pos[3], double vel[3]) {
+  double a = elements.a[body], e = elements.e[body];
+  double M = elements.M0[body] + elements.n[body] * t;
+  M -= TWO_PI * floor(M / TWO_PI + 0.5);
+
+  double E = M + 0.85 * e * (sin(M) < 0.0 ? -1.0 : 1.0);
+  for (int k = 0; k < 32; k++) {
+    double dE = (E - e * sin(E) - M) / (1.0 - e * cos(E));
+    E -= dE;
+    if (fabs(dE) < 1e-14)
+      break;
+  }
+
+  double cw = cos(elements.peri[body]), sw = sin(elements.peri[body]);
+  double cn = cos(elements.node[body]), sn = sin(elements.node[body]);
+  double ci = cos(elements.inc[body]), si = sin(elements.inc[body]);
+  double P[3] = {cw * cn - sw * ci * sn, cw * sn + sw * ci * cn, sw * si};
+  double Q[3] = {-sw * cn - cw * ci * sn, -sw * sn + cw * ci * cn, cw * si};
+
+  double root = sqrt(1.0 - e * e);
+  double X = a * (cos(E) - e), Y = a * root * sin(E);
+  // dE/dt from Kepler's equation, with the mean motion gm implies
+  double Edot = sqrt(gm / (a * a * a)) / (1.0 - e * cos(E));
+  double VX = -a * sin(E) * Edot, VY = a * root * cos(E) * Edot;
+
+  for (int k = 0; k < 3; k++) {
+    pos[k] = X * P[k] + Y * Q[k];
+    vel[k] = VX * P[k] + VY * Q[k];
+  }
+}
+
+size_t stateToElements(OrbitalElements &elements, const double pos[3],
+                       const double vel[3], double gm, double t) {
+  double r = sqrt(pos[0] * pos[0] + pos[1] * pos[1] + pos[2] * pos[2]);
+  double v2 = vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2];
+
+  // angular momentum and eccentricity vector
+  double h[3] = {pos[1] * vel[2] - pos[2] * vel[1],
+                 pos[2] * vel[0] - pos[0] * vel[2],
+                 pos[0] * vel[1] - pos[1] * vel[0]};
+  double hn = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+  double rv = pos[0] * vel[0] + pos[1] * vel[1] + pos[2] * vel[2];
+  double ev[3];
+  for (int k = 0; k < 3; k++)
+    ev[k] = ((v2 - gm / r) * pos[k] - rv * vel[k]) / gm;
+  double e = sqrt(ev[0] * ev[0] + ev[1] * ev[1] + ev[2] * ev[2]);
+
+  double a = 1.0 / (2.0 / r - v2 / gm);
+  double inc = acos(h[2] / hn);
+  // the node is undefined on the ecliptic, measure from the x axis there
+  double node =
+      h[0] * h[0] + h[1] * h[1] > 1e-24 * hn * hn ? atan2(h[0], -h[1]) : 0.0;
+
+  // in-plane basis: N towards the node, M 90 degrees ahead of it
+  double N[3] = {cos(node), sin(node), 0.0};
+  double M[3] = {h[1] * N[2] - h[2] * N[1], h[2] * N[0] - h[0] * N[2],
+                 h[0] * N[1] - h[1] * N[0]};
+  for (int k = 0; k < 3; k++)
+    M[k] /= hn;
+
+  // argument of latitude, then periapsis (zero for circular orbits)
+  double u = atan2(pos[0] * M[0] + pos[1] * M[1] + pos[2] * M[2],
+                   pos[0] * N[0] + pos[1] * N[1] + pos[2] * N[2]);
+  double peri = e > 1e-10 ? atan2(ev[0] * M[0] + ev[1] * M[1] + ev[2] * M[2],
+                                  ev[0] * N[0] + ev[1] * N[1] + ev[2] * N[2])
+                          : 0.0;
+  double nu = u - peri;
+
+  double E = 2.0 * atan2(sqrt(1.0 - e) * sin(nu * 0.5),
+                         sqrt(1.0 + e) * cos(nu * 0.5));
+  double n = sqrt(gm / (a * a * a));
+  double M0 = E - e * sin(E) - n * t;
+
+  return elements.add(a, e, inc, node, peri, M0, n);
+}
+
+bool keplerDrift(double pos[3], double vel[3], double gm, double dt) {
+  double r0 = sqrt(pos[0] * pos[0] + pos[1] * pos[1] + pos[2] * pos[2]);
+  double v2 = vel[0] * vel[0] + vel[1] * vel[1] + vel[2] * vel[2];
+  double a = 1.0 / (2.0 / r0 - v2 / gm);
+  if (!(a > 0.0))
+    return false;
+
+  // whole revolutions change nothing, keep the remainder of the mean anomaly
+  double n = sqrt(gm / (a * a * a));
+  double dM = n * dt;
+  dM -= TWO_PI * floor(dM / TWO_PI + 0.5);
+  dt = dM / n;
+
+  // Kepler's equation in the change of eccentric anomaly x:
+  // x - ec sin x + es (1 - cos x) = dM
+  double rv = pos[0] * vel[0] + pos[1] * vel[1] + pos[2] * vel[2];
+  double ec = 1.0 - r0 / a;
+  double es = rv / (n * a * a);
+  double x = dM;
+  for (int k = 0; k < 32; k++) {
+    double s = sin(x), c = cos(x);
+    double dx = (x - ec * s + es * (1.0 - c) - dM) / (1.0 - ec * c + es * s);
+    x -= dx;
+    if (fabs(dx) < 1e-14)
+      break;
+  }
+
+  double s = sin(x), c = cos(x);
+  double r = a * (1.0 - ec * c + es * s);
+  double f = 1.0 - a / r0 * (1.0 - c);
+  double g = dt + (s - x) / n;
+  double fdot = -a * a * n * s / (r * r0);
+  double gdot = 1.0 - a / r * (1.0 - c);
+  for (int k = 0; k < 3; k++) {
+    double p = pos[k], v = vel[k];
+    pos[k] = f * p + g * v;
+    vel[k] = fdot * p + gdot * v;
+  }
+  return true;
+}
+
+void KeplerPropagator::setElements(const OrbitalElements &elements) {
+  addElements(elements, 0);
+}
+
+void KeplerPropagator::addElements(const OrbitalElements &elements,
+                                   size_t begin) {
+  size_t count = elements.size();
+
+  e.resize(count);
+  a.resize(count);
+  b.resize(count);
+  px.resize(count);
+  py.resize(count);
+  pz.resize(count);
+  qx.resize(count);
+  qy.resize(count);
+  qz.resize(count);
+  M0.resize(count);
+  n.resize(count);
+  M.resize(count);
+
+  for (size_t i = begin; i < count; i++) {
+    double ecc = elements.e[i];
+    double cw = cos(elements.peri[i]), sw = sin(elements.peri[i]);
+    double cn = cos(elements.node[i]), sn = sin(elements.node[i]);
+    double ci = cos(elements.inc[i]), si = sin(elements.inc[i]);
+
+    e[i] = (float)ecc;
+    a[i] = (float)elements.a[i];
+    b[i] = (float)(elements.a[i] * sqrt(1.0 - ecc * ecc));
+
+    // P points at periapsis, Q is 90 degrees ahead of it in the orbit plane
+    px[i] = (float)(cw * cn - sw * ci * sn);
+    py[i] = (float)(cw * sn + sw * ci * cn);
+    pz[i] = (float)(sw * si);
+    qx[i] = (float)(-sw * cn - cw * ci * sn);
+    qy[i] = (float)(-sw * sn + cw * ci * cn);
+    qz[i] = (float)(cw * si);
+
+    M0[i] = elements.M0[i];
+    n[i] = elements.n[i];
+  }
+}
+
+void KeplerPropagator::pointAt(size_t body, double E, float &x, float &y,
+                               float &z) const {
+  float X = a[body] * ((float)cos(E) - e[body]);
+  float Y = b[body] * (float)sin(E);
+  x = X * px[body] + Y * qx[body];
+  y = X * py[body] + Y * qy[body];
+  z = X * pz[body] + Y * qz[body];
+}
+
+// Scalar reference, also handles the tail that does not fill a SIMD register
+static void solveScalar(size_t begin, size_t end, const float *M,
+                        const float *e, const float *a, const float *b,
+                        const float *px, const float *py, const float *pz,
+                        const float *qx, const float *qy, const float *qz,
+                        float *x, float *y, float *z) {
+  for (size_t i = begin; i < end; i++) {
+    float Mi = M[i], ei = e[i];
+    // Danby's starting value converges for every elliptic eccentricity
+    float E = Mi + 0.85f * ei * (sinf(Mi) < 0.0f ? -1.0f : 1.0f);
+    for (int k = 0; k < KEPLER_MAX_ITERATIONS; k++) {
+      float f = E - ei * sinf(E) - Mi;
+      E -= f / (1.0f - ei * cosf(E));
+      if (fabsf(f) < KEPLER_TOLERANCE)
+        break;
+    }
+
+    float X = a[i] * (cosf(E) - ei);
+    float Y = b[i] * sinf(E);
+    x[i] = X * px[i] + Y * qx[i];
+    y[i] = X * py[i] + Y * qy[i];
+    z[i] = X * pz[i] + Y * qz[i];
+  }
+}
+
+// The vector kernels share one body, written against a small set of
+// operations per instruction set. sincos() is a Cephes style polynomial with
+// Cody-Waite reduction to [-pi/4, pi/4], good to a few ulp for the |x| < 8
+// range Kepler's equation produces.
+#if defined(__AVX__)
+
+struct SimdOps {
+  typedef __m256 V;
+  static const int WIDTH = 8;
+  static V load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, V v) { _mm256_storeu_ps(p, v); }
+  static V set1(float f) { return _mm256_set1_ps(f); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm256_div_ps(a, b); }
+  static V lessThan(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static V select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+  static V flipSign(V v, V mask) {
+    return _mm256_xor_ps(v, _mm256_and_ps(mask, set1(-0.0f)));
+  }
+  static V abs(V v) { return _mm256_andnot_ps(set1(-0.0f), v); }
+  static bool allBelow(V v, V limit) {
+    return _mm256_movemask_ps(lessThan(v, limit)) == 0xFF;
+  }
+
+  // quadrant = round(x * 2 / pi), returned as the float count j and the
+  // masks needed to fold the reduced polynomials back
+  static V quadrant(V x, V &swap, V &sinNeg, V &cosNeg) {
+    V j = _mm256_round_ps(mul(x, set1(0.63661977236758134f)),
+                          _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    V q = sub(j, mul(set1(4.0f), _mm256_floor_ps(mul(j, set1(0.25f)))));
+    V one = set1(1.0f), two = set1(2.0f), three = set1(3.0f);
+    swap = _mm256_or_ps(_mm256_cmp_ps(q, one, _CMP_EQ_OQ),
+                        _mm256_cmp_ps(q, three, _CMP_EQ_OQ));
+    sinNeg = _mm256_cmp_ps(q, two, _CMP_GE_OQ);
+    cosNeg = _mm256_or_ps(_mm256_cmp_ps(q, one, _CMP_EQ_OQ),
+                          _mm256_cmp_ps(q, two, _CMP_EQ_OQ));
+    return j;
+  }
+};
+
+#elif defined(__SSE2__)
+
+struct SimdOps {
+  typedef __m128 V;
+  static const int WIDTH = 4;
+  static V load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, V v) { _mm_storeu_ps(p, v); }
+  static V set1(float f) { return _mm_set1_ps(f); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm_div_ps(a, b); }
+  static V lessThan(V a, V b) { return _mm_cmplt_ps(a, b); }
+  static V select(V mask, V a, V b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+  static V flipSign(V v, V mask) {
+    return _mm_xor_ps(v, _mm_and_ps(mask, set1(-0.0f)));
+  }
+  static V abs(V v) { return _mm_andnot_ps(set1(-0.0f), v); }
+  static bool allBelow(V v, V limit) {
+    return _mm_movemask_ps(lessThan(v, limit)) == 0xF;
+  }
+
+  static V quadrant(V x, V &swap, V &sinNeg, V &cosNeg) {
+    // SSE2 has no float rounding, go through the integer unit instead
+    __m128i ji = _mm_cvtps_epi32(mul(x, set1(0.63661977236758134f)));
+    __m128i q = _mm_and_si128(ji, _mm_set1_epi32(3));
+    __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    sinNeg = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, two), two));
+    cosNeg = _mm_castsi128_ps(
+        _mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), two));
+    return _mm_cvtepi32_ps(ji);
+  }
+};
+
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__)
+
+template <class S>
+static inline void sincos(typename S::V x, typename S::V &s,
+                          typename S::V &c) {
+  typedef typename S::V V;
+  V swap, sinNeg, cosNeg;
+  V j = S::quadrant(x, swap, sinNeg, cosNeg);
+
+  // x - j * pi / 2 in three parts so the reduction stays exact
+  V r = S::sub(x, S::mul(j, S::set1(1.5703125f)));
+  r = S::sub(r, S::mul(j, S::set1(4.837512969970703125e-4f)));
+  r = S::sub(r, S::mul(j, S::set1(7.54978995489188216e-8f)));
+  V z = S::mul(r, r);
+
+  V sp = S::add(S::mul(S::set1(-1.9515295891e-4f), z),
+                S::set1(8.3321608736e-3f));
+  sp = S::add(S::mul(sp, z), S::set1(-1.6666654611e-1f));
+  sp = S::add(S::mul(S::mul(sp, z), r), r);
+
+  V cp = S::add(S::mul(S::set1(2.443315711809948e-5f), z),
+                S::set1(-1.388731625493765e-3f));
+  cp = S::add(S::mul(cp, z), S::set1(4.166664568298827e-2f));
+  cp = S::mul(S::mul(cp, z), z);
+  cp = S::add(S::sub(cp, S::mul(S::set1(0.5f), z)), S::set1(1.0f));
+
+  s = S::flipSign(S::select(swap, cp, sp), sinNeg);
+  c = S::flipSign(S::select(swap, sp, cp), cosNeg);
+}
+
+template <class S>
+static size_t solveSimd(size_t begin, size_t end, const float *M,
+                        const float *e, const float *a, const float *b,
+                        const float *px, const float *py, const float *pz,
+                        const float *qx, const float *qy, const float *qz,
+                        float *x, float *y, float *z) {
+  typedef typename S::V V;
+  const V one = S::set1(1.0f);
+  const V tolerance = S::set1(KEPLER_TOLERANCE);
+
+  size_t i = begin;
+  for (; i + S::WIDTH <= end; i += S::WIDTH) {
+    V Mv = S::load(M + i);
+    V ev = S::load(e + i);
+
+    V s, c;
+    sincos<S>(Mv, s, c);
+    V E = S::add(Mv, S::flipSign(S::mul(S::set1(0.85f), ev),
+                                 S::lessThan(s, S::set1(0.0f))));
+
+    for (int k = 0; k < KEPLER_MAX_ITERATIONS; k++) {
+      sincos<S>(E, s, c);
+      V f = S::sub(S::sub(E, S::mul(ev, s)), Mv);
+      V fp = S::sub(one, S::mul(ev, c));
+      E = S::sub(E, S::div(f, fp));
+      if (S::allBelow(S::abs(f), tolerance))
+        break;
+    }
+
+    sincos<S>(E, s, c);
+    V X = S::mul(S::load(a + i), S::sub(c, ev));
+    V Y = S::mul(S::load(b + i), s);
+    S::store(x + i, S::add(S::mul(X, S::load(px + i)),
+                           S::mul(Y, S::load(qx + i))));
+    S::store(y + i, S::add(S::mul(X, S::load(py + i)),
+                           S::mul(Y, S::load(qy + i))));
+    S::store(z + i, S::add(S::mul(X, S::load(pz + i)),
+                           S::mul(Y, S::load(qz + i))));
+  }
+  return i;
+}
+
+#endif
+
+void KeplerPropagator::propagate(double t, float *x, float *y, float *z) {
+  propagateRange(t, 0, size(), x, y, z);
+}
+
+void KeplerPropagator::propagateRange(double t, size_t begin, size_t end,
+                                      float *x, float *y, float *z) {
+  // mean anomalies grow without bound, wrap them to [-pi, pi) while still in
+  // double precision so float is enough for the solver
+  for (size_t i = begin; i < end; i++) {
+    double m = M0[i] + n[i] * t;
+    m -= TWO_PI * floor(m / TWO_PI + 0.5);
+    M[i] = (float)m;
+  }
+
+  size_t i = begin;
+#if defined(__AVX__) || defined(__SSE2__)
+  i = solveSimd<SimdOps>(begin, end, M.data(), e.data(), a.data(), b.data(),
+                         px.data(), py.data(), pz.data(), qx.data(), qy.data(),
+                         qz.data(), x, y, z);
+#endif
+  solveScalar(i, end, M.data(), e.data(), a.data(), b.data(), px.data(),
+              py.data(), pz.data(), qx.data(), qy.data(), qz.data(), x, y, z);
+}
+
+const char *KeplerPropagator::kernelName() {
+#if defined(__AVX__)
+  return "AVX";
+#elif defined(__SSE2__)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
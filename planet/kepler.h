@@ -0,0 +1,97 @@
+#ifndef KEPLER_H
+#define KEPLER_H
+
+#include <cstddef>
+#include <vector>
+
+// Classical orbital elements for a set of bodies, stored as one array per
+// element so the propagator can stream through them. Angles are in radians,
+// distances in astronomical units and time in simulation ticks.
+struct OrbitalElements {
+  std::vector<double> a;    // semi-major axis
+  std::vector<double> e;    // eccentricity, elliptic orbits only [0, 1)
+  std::vector<double> inc;  // inclination
+  std::vector<double> node; // longitude of the ascending node
+  std::vector<double> peri; // argument of periapsis
+  std::vector<double> M0;   // mean anomaly at t = 0
+  std::vector<double> n;    // mean motion, radians per tick
+
+  size_t size() const { return a.size(); }
+
+  void reserve(size_t count);
+  void clear();
+
+  // appends a body and returns its index
+  size_t add(double a, double e, double inc, double node, double peri,
+             double M0, double n);
+};
+
+// Position and velocity of one body at time t, in double precision, for
+// seeding integrators. The position follows the table's mean motion, the
+// velocity is the two-body one around a central mass of parameter gm
+void elementsToState(const OrbitalElements &elements, size_t body, double t,
+                     double gm, double pos[3], double vel[3]);
+
+// Appends the elliptic orbit through pos with velocity vel around a central
+// mass of parameter gm, as seen at time t, and returns its index. The mean
+// motion is the two-body one
+size_t stateToElements(OrbitalElements &elements, const double pos[3],
+                       const double vel[3], double gm, double t);
+
+// Moves a body along its two-body orbit around a mass of parameter gm by dt,
+// with Gauss' f and g functions. Costs one Kepler solve however long dt is.
+// Returns false and leaves the state alone if the orbit is not elliptic
+bool keplerDrift(double pos[3], double vel[3], double gm, double dt);
+
+// Propagates every body of an OrbitalElements table to a given time.
+//
+// Everything that does not depend on time (the orientation of the orbital
+// plane, the semi-minor axis) is computed once in setElements(). Each
+// propagate() call then reduces the mean anomalies in double precision and
+// solves Kepler's equation for all bodies in a single vectorised Newton
+// kernel: AVX when compiled with -mavx, SSE2 on any other x86-64 build and a
+// scalar loop everywhere else.
+//
+// Output positions are in the ecliptic frame (z towards the ecliptic north
+// pole), in astronomical units.
+class KeplerPropagator {
+public:
+  KeplerPropagator() {}
+  explicit KeplerPropagator(const OrbitalElements &elements) {
+    setElements(elements);
+  }
+
+  // (re)builds the per-body constants, call again whenever elements change
+  void setElements(const OrbitalElements &elements);
+
+  // builds the constants of bodies [begin, elements.size()) only, for tables
+  // that grow at the end while bodies [0, begin) stay as they were
+  void addElements(const OrbitalElements &elements, size_t begin);
+
+  size_t size() const { return M0.size(); }
+
+  // writes the position of every body at time t into x, y and z, which must
+  // hold size() floats each
+  void propagate(double t, float *x, float *y, float *z);
+
+  // same as propagate() for bodies [begin, end) only. Disjoint ranges may be
+  // propagated from different threads at the same time
+  void propagateRange(double t, size_t begin, size_t end, float *x, float *y,
+                      float *z);
+
+  // position of one body at eccentric anomaly E, used to draw orbit paths
+  void pointAt(size_t body, double E, float &x, float &y, float &z) const;
+
+  // name of the kernel compiled in, for the UI and benchmarks
+  static const char *kernelName();
+
+private:
+  // per-body constants
+  std::vector<float> e, a, b;
+  std::vector<float> px, py, pz, qx, qy, qz;
+  std::vector<double> M0, n;
+  // reduced mean anomalies of the current propagate() call
+  std::vector<float> M;
+};
+
+#endif
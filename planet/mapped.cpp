@@ -0,0 +1,69 @@
+#include "mapped.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const char *path) {
+  close();
+
+#ifdef _WIN32
+  HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (f == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  HANDLE m = NULL;
+  if (GetFileSizeEx(f, &size) && size.QuadPart > 0)
+    m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (m == NULL) {
+    CloseHandle(f);
+    return false;
+  }
+  file = f;
+  mapping = m;
+  length = (size_t)size.QuadPart;
+  bytes = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+#else
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    length = (size_t)st.st_size;
+    bytes = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (bytes == MAP_FAILED)
+      bytes = NULL;
+  }
+  // the mapping stays valid without the descriptor
+  ::close(fd);
+#endif
+  if (bytes == NULL) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+  if (bytes != NULL)
+    UnmapViewOfFile(bytes);
+  if (mapping != NULL)
+    CloseHandle((HANDLE)mapping);
+  if (file != NULL)
+    CloseHandle((HANDLE)file);
+#else
+  if (bytes != NULL)
+    munmap(bytes, length);
+#endif
+  bytes = NULL;
+  file = NULL;
+  mapping = NULL;
+  length = 0;
+}
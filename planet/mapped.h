@@ -0,0 +1,31 @@
+#ifndef MAPPED_H
+#define MAPPED_H
+
+#include <cstddef>
+
+// A whole file mapped read only into memory. Pages are read in by the OS as
+// they are touched, so opening costs the same whatever the file's size.
+class MappedFile {
+public:
+  MappedFile() : bytes(NULL), length(0), file(NULL), mapping(NULL) {}
+  ~MappedFile() { close(); }
+
+  // maps path, false if it is missing or empty
+  bool open(const char *path);
+  void close();
+  bool isOpen() const { return bytes != NULL; }
+
+  const void *data() const { return bytes; }
+  size_t size() const { return length; }
+
+private:
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+  void *bytes;
+  size_t length;
+  // file and mapping handles on Windows
+  void *file, *mapping;
+};
+
+#endif
@@ -7,7 +7,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <shader.h>
+#include <simplify.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 using namespace std;
@@ -39,11 +41,25 @@ struct Texture {
 
 class Mesh {
 public:
+  // A level of detail: count indices from first on in the element buffer,
+  // at most error model units off the full mesh
+  struct Lod {
+    unsigned int first, count;
+    float error;
+  };
+  // at most this many levels, the full mesh included
+  static const size_t MAX_LODS = 5;
+  // no level is made with fewer triangles
+  static const size_t MIN_LOD_TRIANGLES = 64;
+
   // mesh Data
   vector<Vertex> vertices;
   vector<unsigned int> indices;
   vector<Texture> textures;
   unsigned int VAO;
+  // level 0 is indices itself, every other one is simplified from the one
+  // before to about half its triangles, and they all share the vertices
+  vector<Lod> lods;
 
   // constructor
   Mesh(vector<Vertex> vertices, vector<unsigned int> indices,
@@ -54,7 +70,38 @@ public:
 
     // now that we have all the required data, set the vertex buffers and its
     // attribute pointers.
-    setupMesh();
+    vector<unsigned int> elements;
+    buildLods(elements);
+    setupMesh(elements);
+  }
+
+  // meshes own GL buffers and can be large, they are moved, never copied
+  Mesh(const Mesh &) = delete;
+  Mesh &operator=(const Mesh &) = delete;
+  Mesh(Mesh &&) = default;
+  Mesh &operator=(Mesh &&) = default;
+
+  // frees the buffers, the mesh cannot be drawn afterwards
+  void release() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    VAO = VBO = EBO = 0;
+  }
+
+  // The coarsest level that stays within tolerance pixels of the full mesh
+  // at pixels per model unit on screen. Starting from the level drawn last,
+  // a coarser one has to be well within, so a mesh near a switch does not
+  // flip back and forth between two levels every frame
+  size_t selectLod(float pixels, float tolerance, size_t current) const {
+    const float HYSTERESIS = 0.75f;
+    size_t lod = std::min(current, lods.size() - 1);
+    while (lod > 0 && lods[lod].error * pixels > tolerance)
+      lod--;
+    while (lod + 1 < lods.size() &&
+           lods[lod + 1].error * pixels < tolerance * HYSTERESIS)
+      lod++;
+    return lod;
   }
 
   // render the mesh
@@ -81,7 +128,7 @@ public:
         number = std::to_string(heightNr++); // transfer unsigned int to string
 
       // now set the sampler to the correct texture unit
-      glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+      shader.setInt(name + number, i);
       // and finally bind the texture
       glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
@@ -122,20 +169,20 @@ public:
         number = std::to_string(heightNr++); // transfer unsigned int to string
 
       // now set the sampler to the correct texture unit
-      glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+      shader.setInt(name + number, i);
       // and finally bind the texture
       glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
 
     glActiveTexture(GL_TEXTURE0 + nightID);
-    glUniform1i(glGetUniformLocation(shader.ID, name2.c_str()), nightID);
+    shader.setInt(name2, nightID);
     glBindTexture(GL_TEXTURE_2D, nightID);
 
     glActiveTexture(GL_TEXTURE0 + cloudID);
-    glUniform1i(glGetUniformLocation(shader.ID, name3.c_str()), cloudID);
+    shader.setInt(name3, cloudID);
     glBindTexture(GL_TEXTURE_2D, cloudID);
 
-    glUniform1f(glGetUniformLocation(shader.ID, "time"), time);
+    shader.setFloat("time", time);
 
     // draw mesh
     glBindVertexArray(VAO);
@@ -151,8 +198,33 @@ private:
   // render data
   unsigned int VBO, EBO;
 
+  // the levels of detail, one after the other in elements
+  void buildLods(vector<unsigned int> &elements) {
+    elements = indices;
+    Lod full = {0, (unsigned int)indices.size(), 0.0f};
+    lods.assign(1, full);
+    vector<unsigned int> coarser;
+    while (lods.size() < MAX_LODS && !vertices.empty()) {
+      const Lod &last = lods.back();
+      size_t target = last.count / 6 * 3;
+      if (target < 3 * MIN_LOD_TRIANGLES)
+        break;
+      float error = simplifyMesh(
+          &vertices[0].Position.x, &vertices[0].TexCoords.x, sizeof(Vertex),
+          vertices.size(), &elements[last.first], last.count, target, coarser);
+      // not worth a level when little could be taken away
+      if (coarser.size() > (size_t)last.count * 3 / 4)
+        break;
+      // each level is simplified from the one before, their errors add up
+      Lod lod = {(unsigned int)elements.size(), (unsigned int)coarser.size(),
+                 last.error + error};
+      elements.insert(elements.end(), coarser.begin(), coarser.end());
+      lods.push_back(lod);
+    }
+  }
+
   // initializes all the buffer objects/arrays
-  void setupMesh() {
+  void setupMesh(const vector<unsigned int> &elements) {
     // create buffers/arrays
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -169,8 +241,9 @@ private:
                  &vertices[0], GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-                 &indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 elements.size() * sizeof(unsigned int), &elements[0],
+                 GL_STATIC_DRAW);
 
     // set the vertex attribute pointers
     // vertex Positions
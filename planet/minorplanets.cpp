@@ -0,0 +1,238 @@
+#include "minorplanets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "parallel.h"
+
+static const double DEG = 3.14159265358979323846 / 180.0;
+static const double TWO_PI = 2.0 * 3.14159265358979323846;
+static const double J2000 = 2451545.0;
+// absolute magnitude of the bodies that leave it blank, and the geometric
+// albedo used to turn H into a diameter
+static const double DEFAULT_H = 16.0;
+static const double ALBEDO = 0.14;
+
+void MinorPlanets::clear() {
+  elements.clear();
+  diameter.clear();
+}
+
+// reads the number in columns [first, last] of a catalog line, counted from 1
+// like the MPC format description does
+static bool field(const char *line, size_t first, size_t last,
+                  double &value) {
+  char text[32];
+  size_t length = last - first + 1;
+  memcpy(text, line + first - 1, length);
+  text[length] = '\0';
+
+  char *end;
+  value = strtod(text, &end);
+  if (end == text)
+    return false;
+  while (*end == ' ')
+    end++;
+  return *end == '\0';
+}
+
+// one character of a packed date, 1-9 then A-V for 10-31
+static int unpack(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'V')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Julian date of a packed epoch such as K2555 (2025 May 5.0 TT)
+static bool packedEpoch(const char *packed, double &jd) {
+  int century = packed[0] - 'I' + 18;
+  int month = unpack(packed[3]), day = unpack(packed[4]);
+  if (century < 18 || century > 21 || packed[1] < '0' || packed[1] > '9' ||
+      packed[2] < '0' || packed[2] > '9' || month < 1 || month > 12 ||
+      day < 1)
+    return false;
+  int year = century * 100 + (packed[1] - '0') * 10 + (packed[2] - '0');
+
+  // Fliegel and Van Flandern's day number, which starts at noon
+  int m = (month - 14) / 12;
+  long jdn = (1461L * (year + 4800 + m)) / 4 +
+             (367L * (month - 2 - 12 * m)) / 12 -
+             (3L * ((year + 4900 + m) / 100)) / 4 + day - 32075;
+  jd = jdn - 0.5;
+  return true;
+}
+
+bool parseMinorPlanet(const char *line, size_t length, double daysPerTick,
+                      MinorPlanets &planets) {
+  // the orbit ends with the semi-major axis in columns 93-103
+  if (length < 103)
+    return false;
+
+  double M, peri, node, inc, e, n, a, epoch;
+  if (!field(line, 27, 35, M) || !field(line, 38, 46, peri) ||
+      !field(line, 49, 57, node) || !field(line, 60, 68, inc) ||
+      !field(line, 71, 79, e) || !field(line, 81, 91, n) ||
+      !field(line, 93, 103, a) || !packedEpoch(line + 20, epoch))
+    return false;
+  if (a <= 0.0 || e < 0.0 || e >= 1.0 || n <= 0.0)
+    return false;
+
+  double H;
+  if (!field(line, 9, 13, H))
+    H = DEFAULT_H;
+
+  double M0 = fmod((M + n * (J2000 - epoch)) * DEG, TWO_PI);
+  if (M0 < 0.0)
+    M0 += TWO_PI;
+  planets.elements.add(a, e, inc * DEG, node * DEG, peri * DEG, M0,
+                       n * DEG * daysPerTick);
+  planets.diameter.push_back(
+      (float)(1329.0 / sqrt(ALBEDO) * pow(10.0, -H / 5.0)));
+  return true;
+}
+
+template <typename T>
+static void append(std::vector<T> &to, const std::vector<T> &from) {
+  to.insert(to.end(), from.begin(), from.end());
+}
+
+static void append(MinorPlanets &to, const MinorPlanets &from) {
+  append(to.elements.a, from.elements.a);
+  append(to.elements.e, from.elements.e);
+  append(to.elements.inc, from.elements.inc);
+  append(to.elements.node, from.elements.node);
+  append(to.elements.peri, from.elements.peri);
+  append(to.elements.M0, from.elements.M0);
+  append(to.elements.n, from.elements.n);
+  append(to.diameter, from.diameter);
+}
+
+bool MinorPlanetLoader::start(const std::string &path, double daysPerTick) {
+  stop();
+
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    std::cout << "ERROR::MINOR_PLANETS::Could not read " << path << std::endl;
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  fileBytes = size > 0 ? (size_t)size : 0;
+  bytesRead = 0;
+  count = 0;
+  rejected = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    staging.clear();
+  }
+
+  running = true;
+  thread = std::thread(&MinorPlanetLoader::run, this, file, daysPerTick);
+  return true;
+}
+
+void MinorPlanetLoader::stop() {
+  cancelled = true;
+  if (thread.joinable())
+    thread.join();
+  cancelled = false;
+}
+
+size_t MinorPlanetLoader::take(MinorPlanets &planets) {
+  std::lock_guard<std::mutex> lock(mutex);
+  size_t taken = staging.size();
+  if (taken == 0)
+    return 0;
+  if (planets.size() == 0)
+    std::swap(planets, staging);
+  else
+    append(planets, staging);
+  staging.clear();
+  return taken;
+}
+
+void MinorPlanetLoader::run(FILE *file, double daysPerTick) {
+  ThreadPool pool(threads);
+  size_t pieces = pool.size() * 4;
+  std::vector<MinorPlanets> parts(pieces);
+  std::vector<size_t> bounds(pieces + 1);
+
+  std::vector<char> data;
+  size_t kept = 0;
+  while (!cancelled) {
+    data.resize(kept + CHUNK_BYTES);
+    size_t got = fread(&data[kept], 1, CHUNK_BYTES, file);
+    bytesRead += got;
+    size_t size = kept + got;
+    bool last = got < CHUNK_BYTES;
+
+    // parse whole lines only, the tail is kept for the next chunk
+    size_t end = size;
+    if (!last) {
+      while (end > 0 && data[end - 1] != '\n')
+        end--;
+      if (end == 0)
+        end = size;
+    }
+
+    // pieces start right after a line break
+    const char *text = data.empty() ? NULL : &data[0];
+    bounds[0] = 0;
+    for (size_t p = 1; p < pieces; p++) {
+      size_t b = std::max(bounds[p - 1], end * p / pieces);
+      while (b > 0 && b < end && text[b - 1] != '\n')
+        b++;
+      bounds[p] = b;
+    }
+    bounds[pieces] = end;
+
+    pool.parallelFor(
+        pieces,
+        [&](size_t first, size_t past) {
+          for (size_t p = first; p < past; p++) {
+            parts[p].clear();
+            size_t skipped = 0;
+            size_t i = bounds[p];
+            while (i < bounds[p + 1]) {
+              const char *line = text + i;
+              const char *stop = (const char *)memchr(line, '\n',
+                                                      bounds[p + 1] - i);
+              size_t length =
+                  stop != NULL ? stop - line : bounds[p + 1] - i;
+              i += length + 1;
+              if (length > 0 && line[length - 1] == '\r')
+                length--;
+              if (length > 0 &&
+                  !parseMinorPlanet(line, length, daysPerTick, parts[p]))
+                skipped++;
+            }
+            rejected += skipped;
+          }
+        },
+        1);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (size_t p = 0; p < pieces; p++) {
+        append(staging, parts[p]);
+        count += parts[p].size();
+      }
+    }
+
+    kept = size - end;
+    if (kept > 0)
+      memmove(&data[0], &data[end], kept);
+    if (last)
+      break;
+  }
+
+  fclose(file);
+  running = false;
+}
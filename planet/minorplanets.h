@@ -0,0 +1,86 @@
+#ifndef MINORPLANETS_H
+#define MINORPLANETS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kepler.h"
+
+// Asteroids of the Minor Planet Center orbit catalog (MPCORB.DAT), one array
+// per field like the rest of the simulation.
+struct MinorPlanets {
+  OrbitalElements elements;
+  // estimated from the absolute magnitude, in km
+  std::vector<float> diameter;
+
+  size_t size() const { return elements.size(); }
+  void clear();
+};
+
+// Parses one line of MPCORB.DAT into planets. The catalog's mean motions are
+// in degrees per day and are converted with daysPerTick; mean anomalies are
+// moved from each orbit's epoch to J2000, which the scene treats as t = 0.
+// Returns false for header, blank and malformed lines
+bool parseMinorPlanet(const char *line, size_t length, double daysPerTick,
+                      MinorPlanets &planets);
+
+// Reads MPCORB.DAT (about 1.4 million orbits, 300 MB) without holding up the
+// caller.
+//
+// A loader thread reads the file CHUNK_BYTES at a time and parses each chunk
+// on a ThreadPool of its own, split into pieces at line boundaries. Parsed
+// bodies go to a staging table in file order, which the render thread drains
+// with take() once a frame: the scene starts at once and the catalog fills
+// in while the file is still being read.
+class MinorPlanetLoader {
+public:
+  static const size_t CHUNK_BYTES = 4 << 20;
+
+  // threads = 0 parses on every hardware thread
+  explicit MinorPlanetLoader(unsigned threads = 0)
+      : threads(threads), running(false), cancelled(false), fileBytes(0),
+        bytesRead(0), count(0), rejected(0) {}
+  ~MinorPlanetLoader() { stop(); }
+
+  // starts reading path in the background. Returns false if the file cannot
+  // be opened
+  bool start(const std::string &path, double daysPerTick);
+
+  // stops reading and waits for the loader thread
+  void stop();
+
+  // appends the bodies parsed since the last call to planets and returns how
+  // many there were
+  size_t take(MinorPlanets &planets);
+
+  bool loading() const { return running; }
+  // fraction of the file read so far
+  float progress() const {
+    return fileBytes > 0 ? (float)bytesRead / (float)fileBytes : 0.0f;
+  }
+  // bodies parsed, and catalog lines that were not orbits
+  size_t parsed() const { return count; }
+  size_t skipped() const { return rejected; }
+
+private:
+  MinorPlanetLoader(const MinorPlanetLoader &);
+  MinorPlanetLoader &operator=(const MinorPlanetLoader &);
+
+  void run(FILE *file, double daysPerTick);
+
+  unsigned threads;
+  std::thread thread;
+  std::atomic<bool> running, cancelled;
+  size_t fileBytes;
+  std::atomic<size_t> bytesRead, count, rejected;
+
+  std::mutex mutex;
+  MinorPlanets staging;
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include <mesh.h>
 #include <shader.h>
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -21,8 +22,8 @@
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory,
-                             bool gamma = false);
+inline unsigned int TextureFromFile(const char *path, const string &directory,
+                                    bool gamma = false);
 
 class Model {
 public:
@@ -33,10 +34,30 @@ public:
   vector<Mesh> meshes;
   string directory;
   bool gammaCorrection;
+  // farthest any vertex is from the model's origin, for culling
+  float radius;
 
   // constructor, expects a filepath to a 3D model.
-  Model(string const &path, bool gamma = false) : gammaCorrection(gamma) {
+  Model(string const &path, bool gamma = false)
+      : gammaCorrection(gamma), radius(0.0f) {
     loadModel(path);
+    for (unsigned int i = 0; i < meshes.size(); i++)
+      for (unsigned int v = 0; v < meshes[i].vertices.size(); v++)
+        radius = std::max(radius, glm::length(meshes[i].vertices[v].Position));
+  }
+
+  // owned by the asset registry, see assets.h
+  Model(const Model &) = delete;
+  Model &operator=(const Model &) = delete;
+
+  // frees the meshes and textures
+  void release() {
+    for (unsigned int i = 0; i < meshes.size(); i++)
+      meshes[i].release();
+    for (unsigned int i = 0; i < textures_loaded.size(); i++)
+      glDeleteTextures(1, &textures_loaded[i].id);
+    meshes.clear();
+    textures_loaded.clear();
   }
 
   // draws the model, and thus all its meshes
@@ -215,8 +236,8 @@ private:
   }
 };
 
-unsigned int TextureFromFile(const char *path, const string &directory,
-                             bool gamma) {
+inline unsigned int TextureFromFile(const char *path, const string &directory,
+                                    bool gamma) {
   string filename = string(path);
   filename = directory + '/' + filename;
 
@@ -0,0 +1,289 @@
+#include "nbody.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void NBody::reserve(size_t count) {
+  x.reserve(count);
+  y.reserve(count);
+  z.reserve(count);
+  vx.reserve(count);
+  vy.reserve(count);
+  vz.reserve(count);
+  gm.reserve(count);
+}
+
+void NBody::clear() {
+  x.clear();
+  y.clear();
+  z.clear();
+  vx.clear();
+  vy.clear();
+  vz.clear();
+  gm.clear();
+  prevX.clear();
+  prevY.clear();
+  prevZ.clear();
+  nodes.clear();
+}
+
+size_t NBody::add(double x, double y, double z, double vx, double vy,
+                  double vz, double gm) {
+  this->x.push_back(x);
+  this->y.push_back(y);
+  this->z.push_back(z);
+  this->vx.push_back(vx);
+  this->vy.push_back(vy);
+  this->vz.push_back(vz);
+  this->gm.push_back(gm);
+  prevX.push_back(x);
+  prevY.push_back(y);
+  prevZ.push_back(z);
+  return this->x.size() - 1;
+}
+
+void NBody::step(double dt, const std::vector<Attractor> &attractors,
+                 ThreadPool &pool) {
+  size_t count = size();
+  if (count == 0)
+    return;
+
+  prevX = x;
+  prevY = y;
+  prevZ = z;
+
+  double half = dt * 0.5;
+  pool.parallelFor(count, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      x[i] += vx[i] * half;
+      y[i] += vy[i] * half;
+      z[i] += vz[i] * half;
+    }
+  });
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  buildTree();
+  buildSeconds = secondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  accelerations(attractors, pool);
+  forceSeconds = secondsSince(start);
+
+  pool.parallelFor(count, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      vx[i] += ax[i] * dt;
+      vy[i] += ay[i] * dt;
+      vz[i] += az[i] * dt;
+      x[i] += vx[i] * half;
+      y[i] += vy[i] * half;
+      z[i] += vz[i] * half;
+    }
+  });
+}
+
+void NBody::buildTree() {
+  size_t count = size();
+  order.resize(count);
+  scratch.resize(count);
+  for (size_t i = 0; i < count; i++)
+    order[i] = (uint32_t)i;
+
+  double minX = x[0], maxX = x[0];
+  double minY = y[0], maxY = y[0];
+  double minZ = z[0], maxZ = z[0];
+  for (size_t i = 1; i < count; i++) {
+    minX = std::min(minX, x[i]);
+    maxX = std::max(maxX, x[i]);
+    minY = std::min(minY, y[i]);
+    maxY = std::max(maxY, y[i]);
+    minZ = std::min(minZ, z[i]);
+    maxZ = std::max(maxZ, z[i]);
+  }
+  double half =
+      0.5 * std::max(maxX - minX, std::max(maxY - minY, maxZ - minZ));
+  // grow the root a little so bodies on the boundary land inside
+  half = half * 1.0001 + 1e-12;
+
+  nodes.clear();
+  nodes.reserve(count / LEAF_SIZE * 2 + 1);
+  nodes.push_back(Node());
+  buildNode(0, 0, (uint32_t)count, 0.5 * (minX + maxX), 0.5 * (minY + maxY),
+            0.5 * (minZ + maxZ), half, 0);
+
+  // copy the bodies in tree order, leaves then read contiguous memory
+  sx.resize(count);
+  sy.resize(count);
+  sz.resize(count);
+  sgm.resize(count);
+  for (size_t k = 0; k < count; k++) {
+    uint32_t i = order[k];
+    sx[k] = x[i];
+    sy[k] = y[i];
+    sz[k] = z[i];
+    sgm[k] = gm[i];
+  }
+}
+
+void NBody::buildNode(uint32_t index, uint32_t begin, uint32_t end, double ox,
+                      double oy, double oz, double half, unsigned depth) {
+  if (end - begin <= LEAF_SIZE || depth >= MAX_DEPTH) {
+    double m = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+    for (uint32_t k = begin; k < end; k++) {
+      uint32_t i = order[k];
+      m += gm[i];
+      cx += gm[i] * x[i];
+      cy += gm[i] * y[i];
+      cz += gm[i] * z[i];
+    }
+
+    Node &node = nodes[index];
+    node.gm = m;
+    node.cx = m > 0.0 ? cx / m : ox;
+    node.cy = m > 0.0 ? cy / m : oy;
+    node.cz = m > 0.0 ? cz / m : oz;
+    node.size2 = 4.0 * half * half;
+    node.begin = begin;
+    node.end = end;
+    node.leaf = true;
+    return;
+  }
+
+  // counting sort of [begin, end) by octant
+  uint32_t counts[8] = {0};
+  for (uint32_t k = begin; k < end; k++) {
+    uint32_t i = order[k];
+    unsigned octant = (x[i] > ox) | (y[i] > oy) << 1 | (z[i] > oz) << 2;
+    counts[octant]++;
+  }
+  uint32_t starts[9];
+  starts[0] = begin;
+  for (unsigned o = 0; o < 8; o++)
+    starts[o + 1] = starts[o] + counts[o];
+
+  uint32_t fill[8];
+  std::copy(starts, starts + 8, fill);
+  for (uint32_t k = begin; k < end; k++) {
+    uint32_t i = order[k];
+    unsigned octant = (x[i] > ox) | (y[i] > oy) << 1 | (z[i] > oz) << 2;
+    scratch[fill[octant]++] = i;
+  }
+  std::copy(scratch.begin() + begin, scratch.begin() + end,
+            order.begin() + begin);
+
+  // children of a cell are stored next to each other
+  unsigned childCount = 0;
+  for (unsigned o = 0; o < 8; o++)
+    if (counts[o] > 0)
+      childCount++;
+  uint32_t firstChild = (uint32_t)nodes.size();
+  nodes.resize(nodes.size() + childCount);
+
+  double quarter = half * 0.5;
+  uint32_t child = firstChild;
+  for (unsigned o = 0; o < 8; o++) {
+    if (counts[o] == 0)
+      continue;
+    buildNode(child++, starts[o], starts[o + 1],
+              ox + (o & 1 ? quarter : -quarter),
+              oy + (o & 2 ? quarter : -quarter),
+              oz + (o & 4 ? quarter : -quarter), quarter, depth + 1);
+  }
+
+  double m = 0.0, cx = 0.0, cy = 0.0, cz = 0.0;
+  for (uint32_t c = firstChild; c < firstChild + childCount; c++) {
+    m += nodes[c].gm;
+    cx += nodes[c].gm * nodes[c].cx;
+    cy += nodes[c].gm * nodes[c].cy;
+    cz += nodes[c].gm * nodes[c].cz;
+  }
+
+  Node &node = nodes[index];
+  node.gm = m;
+  node.cx = m > 0.0 ? cx / m : ox;
+  node.cy = m > 0.0 ? cy / m : oy;
+  node.cz = m > 0.0 ? cz / m : oz;
+  node.size2 = 4.0 * half * half;
+  node.begin = firstChild;
+  node.end = firstChild + childCount;
+  node.leaf = false;
+}
+
+void NBody::accelerations(const std::vector<Attractor> &attractors,
+                          ThreadPool &pool) {
+  size_t count = size();
+  ax.resize(count);
+  ay.resize(count);
+  az.resize(count);
+
+  double theta2 = theta * theta;
+  double eps2 = softening * softening;
+
+  // bodies are walked in tree order so neighbouring threads and iterations
+  // visit the same cells
+  pool.parallelFor(
+      count,
+      [&](size_t begin, size_t end) {
+        uint32_t stack[8 * MAX_DEPTH + 8];
+        for (size_t k = begin; k < end; k++) {
+          double px = sx[k], py = sy[k], pz = sz[k];
+          double fx = 0.0, fy = 0.0, fz = 0.0;
+
+          unsigned top = 0;
+          stack[top++] = 0;
+          while (top > 0) {
+            const Node &node = nodes[stack[--top]];
+            if (node.leaf) {
+              for (uint32_t j = node.begin; j < node.end; j++) {
+                if (j == k)
+                  continue;
+                double dx = sx[j] - px, dy = sy[j] - py, dz = sz[j] - pz;
+                double r2 = dx * dx + dy * dy + dz * dz + eps2;
+                double s = sgm[j] / (r2 * sqrt(r2));
+                fx += dx * s;
+                fy += dy * s;
+                fz += dz * s;
+              }
+              continue;
+            }
+
+            double dx = node.cx - px, dy = node.cy - py, dz = node.cz - pz;
+            double d2 = dx * dx + dy * dy + dz * dz;
+            if (node.size2 < theta2 * d2) {
+              double r2 = d2 + eps2;
+              double s = node.gm / (r2 * sqrt(r2));
+              fx += dx * s;
+              fy += dy * s;
+              fz += dz * s;
+            } else {
+              for (uint32_t c = node.begin; c < node.end; c++)
+                stack[top++] = c;
+            }
+          }
+
+          for (size_t a = 0; a < attractors.size(); a++) {
+            double dx = attractors[a].x - px;
+            double dy = attractors[a].y - py;
+            double dz = attractors[a].z - pz;
+            double r2 = dx * dx + dy * dy + dz * dz + eps2;
+            double s = attractors[a].gm / (r2 * sqrt(r2));
+            fx += dx * s;
+            fy += dy * s;
+            fz += dz * s;
+          }
+
+          uint32_t i = order[k];
+          ax[i] = fx;
+          ay[i] = fy;
+          az[i] = fz;
+        }
+      },
+      256);
+}
@@ -0,0 +1,93 @@
+#ifndef NBODY_H
+#define NBODY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "parallel.h"
+
+// A massive body that pulls on the N-body set but is moved by something else
+// (the Sun and the planets, which follow their Keplerian orbits). gm is the
+// gravitational parameter G * m.
+struct Attractor {
+  double x, y, z;
+  double gm;
+};
+
+// Gravitational N-body set integrated with a Barnes-Hut octree.
+//
+// The octree is rebuilt from scratch every step: bodies are partitioned into
+// octants until a cell holds at most LEAF_SIZE of them, and every cell stores
+// the total mass and centre of mass of what is below it. Forces are then
+// evaluated for all bodies in parallel, using a cell as a single point mass
+// when it is smaller than theta times its distance. Attractors are summed
+// directly on top of that and do not feel the bodies back.
+//
+// Integration is drift-kick-drift leapfrog, so each step needs one force
+// evaluation, at the middle of the step. Units are whatever the caller uses
+// for positions, time and gm; the solar system scene uses AU and ticks.
+class NBody {
+public:
+  // positions, velocities and gravitational parameters, one array each
+  std::vector<double> x, y, z;
+  std::vector<double> vx, vy, vz;
+  std::vector<double> gm;
+  // positions before the latest step, to interpolate between steps
+  std::vector<double> prevX, prevY, prevZ;
+
+  // opening angle, smaller is more accurate and slower
+  double theta;
+  // Plummer softening length, keeps close encounters finite
+  double softening;
+
+  // timings of the latest step, in seconds
+  double buildSeconds;
+  double forceSeconds;
+
+  NBody() : theta(0.7), softening(1e-4), buildSeconds(0), forceSeconds(0) {}
+
+  size_t size() const { return x.size(); }
+
+  void reserve(size_t count);
+  void clear();
+  size_t add(double x, double y, double z, double vx, double vy, double vz,
+             double gm);
+
+  // advances every body by dt. attractors are the massive bodies at the
+  // middle of the step
+  void step(double dt, const std::vector<Attractor> &attractors,
+            ThreadPool &pool);
+
+  // number of cells in the latest octree
+  size_t treeSize() const { return nodes.size(); }
+
+private:
+  static const unsigned LEAF_SIZE = 8;
+  static const unsigned MAX_DEPTH = 32;
+
+  struct Node {
+    // centre of mass and total gm of everything in the cell
+    double cx, cy, cz, gm;
+    // edge length of the cell, squared
+    double size2;
+    // leaves: bodies [begin, end) of the sorted arrays
+    // inner cells: children [begin, end) of nodes
+    uint32_t begin, end;
+    bool leaf;
+  };
+
+  void buildTree();
+  void buildNode(uint32_t index, uint32_t begin, uint32_t end, double ox,
+                 double oy, double oz, double half, unsigned depth);
+  void accelerations(const std::vector<Attractor> &attractors,
+                     ThreadPool &pool);
+
+  std::vector<Node> nodes;
+  // bodies in tree order: order[k] is the index of the k-th sorted body
+  std::vector<uint32_t> order, scratch;
+  std::vector<double> sx, sy, sz, sgm;
+  std::vector<double> ax, ay, az;
+};
+
+#endif
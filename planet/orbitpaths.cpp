@@ -0,0 +1,148 @@
+#include "orbitpaths.h"
+
+#include <algorithm>
+#include <cmath>
+
+// points per orbit used to find roughly where it passes closest to the camera
+static const int PROBE_POINTS = 64;
+// the counts are worked out again once the camera moved this much of its
+// distance to the nearest orbit, or the view zoomed by this factor
+static const float MOVE_FRACTION = 0.25f;
+static const float ZOOM_FACTOR = 1.25f;
+
+void OrbitPaths::tessellate(const KeplerPropagator &orbits,
+                            const glm::vec3 &eye,
+                            std::vector<GLsizei> &segments) {
+  segments.resize(orbits.size());
+  closest = HUGE_VALF;
+  for (size_t k = 0; k < orbits.size(); k++) {
+    auto distance = [&](double E) {
+      float x, y, z;
+      orbits.pointAt(k, E, x, y, z);
+      return glm::length(glm::vec3(x, z, -y) * unit - eye);
+    };
+    float radius = 0.0f;
+    int best = 0;
+    float nearest = HUGE_VALF;
+    for (int i = 0; i < PROBE_POINTS; i++) {
+      float x, y, z;
+      orbits.pointAt(k, 2.0 * M_PI * i / PROBE_POINTS, x, y, z);
+      radius = std::max(radius, glm::length(glm::vec3(x, y, z)) * unit);
+      float d = distance(2.0 * M_PI * i / PROBE_POINTS);
+      if (d < nearest) {
+        nearest = d;
+        best = i;
+      }
+    }
+    // the nearest point is between the probes either side of the nearest
+    // probe, narrow it down by ternary search
+    double low = 2.0 * M_PI * (best - 1) / PROBE_POINTS,
+           high = 2.0 * M_PI * (best + 1) / PROBE_POINTS;
+    for (int i = 0; i < 24; i++) {
+      double a = low + (high - low) / 3.0, b = high - (high - low) / 3.0;
+      if (distance(a) < distance(b))
+        high = b;
+      else
+        low = a;
+    }
+    nearest = std::max(std::min(nearest, distance(0.5 * (low + high))), 1e-3f);
+    closest = std::min(closest, nearest);
+
+    float needed = (float)M_PI *
+                   sqrtf(radius * pixels / (2.0f * tolerance * nearest));
+    int n = minSegments;
+    while (n < needed && n < maxSegments)
+      n *= 2;
+    segments[k] = std::min(n, maxSegments);
+  }
+}
+
+bool OrbitPaths::update(const OrbitalElements &elements,
+                        const KeplerPropagator &orbits, float unit,
+                        const glm::vec3 &eye, float pixels) {
+  // the mean anomaly and motion move the body along its orbit, the rest is
+  // the orbit
+  std::vector<double> now;
+  now.reserve(elements.size() * 5);
+  for (size_t k = 0; k < elements.size(); k++) {
+    now.push_back(elements.a[k]);
+    now.push_back(elements.e[k]);
+    now.push_back(elements.inc[k]);
+    now.push_back(elements.node[k]);
+    now.push_back(elements.peri[k]);
+  }
+  bool reshaped = vbo == 0 || now != shape || unit != this->unit;
+  bool moved = reshaped ||
+               glm::length(eye - this->eye) > MOVE_FRACTION * closest ||
+               pixels > this->pixels * ZOOM_FACTOR ||
+               pixels * ZOOM_FACTOR < this->pixels;
+  if (!moved)
+    return false;
+
+  shape.swap(now);
+  this->unit = unit;
+  this->eye = eye;
+  this->pixels = pixels;
+  std::vector<GLsizei> segments;
+  tessellate(orbits, eye, segments);
+  if (!reshaped && segments == count)
+    return false;
+
+  // evenly spaced in eccentric anomaly, so the points bunch up where the
+  // orbit curves the most
+  size_t bodies = orbits.size();
+  count.swap(segments);
+  first.resize(bodies);
+  total = 0;
+  for (size_t k = 0; k < bodies; k++) {
+    first[k] = (GLint)total;
+    total += count[k];
+  }
+  std::vector<float> vertices(total * 3);
+  for (size_t k = 0; k < bodies; k++) {
+    for (GLsizei i = 0; i < count[k]; i++) {
+      float x, y, z;
+      orbits.pointAt(k, 2.0 * M_PI * i / count[k], x, y, z);
+      // ecliptic to the scene's frame, as eclipticToWorld() does
+      float *vertex = &vertices[(first[k] + i) * 3];
+      vertex[0] = x * unit;
+      vertex[1] = z * unit;
+      vertex[2] = -y * unit;
+    }
+  }
+
+  if (vbo == 0) {
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                          (void *)0);
+    glBindVertexArray(0);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float),
+               vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+  return true;
+}
+
+void OrbitPaths::draw() const {
+  if (vao == 0 || count.empty())
+    return;
+  glBindVertexArray(vao);
+  glMultiDrawArrays(GL_LINE_LOOP, &first[0], &count[0], (GLsizei)count.size());
+  glBindVertexArray(0);
+}
+
+void OrbitPaths::release() {
+  if (vbo != 0) {
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+  }
+  vao = vbo = 0;
+  shape.clear();
+  first.clear();
+  count.clear();
+  total = 0;
+}
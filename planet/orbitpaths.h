@@ -0,0 +1,77 @@
+#ifndef ORBITPATHS_H
+#define ORBITPATHS_H
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "kepler.h"
+
+// Line loops along the orbits of a set of bodies, built into one static
+// vertex buffer and drawn with a single glMultiDrawArrays().
+//
+// Every orbit gets as many segments as it takes for its chords to stay within
+// tolerance pixels of the true ellipse where the orbit passes closest to the
+// camera: a chord of an orbit of radius a cut in N misses it by a pi^2 / 2N^2
+// at most, which seen from a distance d is that over d times the pixels per
+// radian of the view. Counts are rounded up to powers of two so small camera
+// moves do not change them, and they are only worked out again once the
+// camera has moved by a good part of its distance to the nearest orbit or the
+// field of view has changed. The buffer is built again when a count, the
+// shape of an orbit or the scale of the scene changes.
+class OrbitPaths {
+public:
+  // allowed distance between a chord and its orbit on screen, in pixels
+  float tolerance;
+  // segments of an orbit, whatever the view
+  int minSegments, maxSegments;
+
+  OrbitPaths()
+      : tolerance(0.5f), minSegments(32), maxSegments(8192), vao(0), vbo(0),
+        unit(0.0f), pixels(0.0f), closest(0.0f), total(0) {}
+
+  // makes sure the paths match the orbits, in the scene's y up frame at unit
+  // world units per AU, for a camera at eye whose view spans pixels per
+  // radian. Returns true if they had to be built again
+  bool update(const OrbitalElements &elements, const KeplerPropagator &orbits,
+              float unit, const glm::vec3 &eye, float pixels);
+
+  // draws every path, with the line shader in use
+  void draw() const;
+
+  // frees the buffers, the next update() builds everything again
+  void release();
+
+  // vertices in the buffer, over every orbit
+  size_t vertices() const { return total; }
+  // segments of orbit k
+  int segments(size_t k) const { return count[k]; }
+
+private:
+  OrbitPaths(const OrbitPaths &);
+  OrbitPaths &operator=(const OrbitPaths &);
+
+  // segments every orbit needs seen from eye
+  void tessellate(const KeplerPropagator &orbits, const glm::vec3 &eye,
+                  std::vector<GLsizei> &segments);
+
+  GLuint vao, vbo;
+  // what the buffer was built from: the elements that shape an orbit, one
+  // after the other for every body, and the scale
+  std::vector<double> shape;
+  float unit;
+  // view the counts were worked out for, and its distance to the nearest
+  // orbit
+  glm::vec3 eye;
+  float pixels;
+  float closest;
+  // first vertex and vertex count of every loop
+  std::vector<GLint> first;
+  std::vector<GLsizei> count;
+  size_t total;
+};
+
+#endif
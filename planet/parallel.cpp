@@ -0,0 +1,144 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <chrono>
+
+ThreadPool::ThreadPool(unsigned threads)
+    : stopping(false), generation(0), busy(0), task(NULL), count(0),
+      chunk(0), next(0) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned i = 1; i < threads; i++)
+    workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+}
+
+void ThreadPool::parallelFor(size_t count, const Task &task, size_t grain) {
+  if (count == 0)
+    return;
+
+  if (workers.empty() || count <= grain) {
+    task(0, count);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->task = &task;
+    this->count = count;
+    // a few chunks per thread so uneven ranges still balance out
+    chunk = std::max(grain, count / (size() * 4) + 1);
+    next.store(0);
+    busy = (unsigned)workers.size();
+    generation++;
+  }
+  wake.notify_all();
+
+  runChunks();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while (busy > 0)
+    done.wait(lock);
+  this->task = NULL;
+}
+
+void ThreadPool::runChunks() {
+  for (;;) {
+    size_t begin = next.fetch_add(chunk);
+    if (begin >= count)
+      return;
+    (*task)(begin, std::min(begin + chunk, count));
+  }
+}
+
+void ThreadPool::workerLoop() {
+  unsigned long seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (!stopping && generation == seen)
+        wake.wait(lock);
+      if (stopping)
+        return;
+      seen = generation;
+    }
+
+    runChunks();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--busy == 0)
+      done.notify_one();
+  }
+}
+
+BackgroundJob::BackgroundJob(unsigned threads)
+    : jobSeconds(0), waitSeconds(0), pool(threads), pending(false),
+      stopping(false), thread(&BackgroundJob::loop, this) {}
+
+BackgroundJob::~BackgroundJob() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+void BackgroundJob::start(const Job &job) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (pending)
+      done.wait(lock);
+    this->job = job;
+    pending = true;
+  }
+  wake.notify_one();
+}
+
+void BackgroundJob::wait() {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mutex);
+  while (pending)
+    done.wait(lock);
+  waitSeconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+}
+
+void BackgroundJob::loop() {
+  for (;;) {
+    Job current;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      while (!stopping && !pending)
+        wake.wait(lock);
+      if (stopping)
+        return;
+      current.swap(job);
+    }
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    current(pool);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    jobSeconds = seconds;
+    pending = false;
+    done.notify_all();
+  }
+}
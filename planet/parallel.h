@@ -0,0 +1,86 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that split loops between them. Threads are
+// started once and sleep between jobs, so a parallelFor() costs a wake up and
+// not a thread creation, which matters when it runs every simulation step.
+//
+// parallelFor() is meant to be called from one thread at a time (the render
+// or simulation thread); the calling thread works on the loop as well.
+class ThreadPool {
+public:
+  typedef std::function<void(size_t begin, size_t end)> Task;
+
+  // threads = 0 uses every hardware thread
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  // number of threads that work on a loop, including the caller
+  unsigned size() const { return (unsigned)workers.size() + 1; }
+
+  // calls task(begin, end) on disjoint ranges covering [0, count) and returns
+  // once all of them are done. Ranges are at least grain long
+  void parallelFor(size_t count, const Task &task, size_t grain = 1024);
+
+private:
+  void workerLoop();
+  void runChunks();
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  bool stopping;
+  unsigned long generation;
+  unsigned busy;
+
+  const Task *task;
+  size_t count;
+  size_t chunk;
+  std::atomic<size_t> next;
+};
+
+// Runs one job at a time on a thread of its own, split over a pool of its own,
+// so the thread that started it carries on with other work meanwhile.
+class BackgroundJob {
+public:
+  typedef std::function<void(ThreadPool &pool)> Job;
+
+  // seconds the latest job took, and the latest wait() blocked for it
+  double jobSeconds;
+  double waitSeconds;
+
+  // threads = 0 splits jobs over every hardware thread
+  explicit BackgroundJob(unsigned threads = 0);
+  ~BackgroundJob();
+
+  // starts job once the previous one is done
+  void start(const Job &job);
+  // returns once the latest job is done
+  void wait();
+
+private:
+  BackgroundJob(const BackgroundJob &);
+  BackgroundJob &operator=(const BackgroundJob &);
+
+  void loop();
+
+  ThreadPool pool;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  Job job;
+  bool pending;
+  bool stopping;
+  std::thread thread;
+};
+
+#endif
@@ -2,7 +2,9 @@
 #include <algorithm>
 #include <chrono>
 #include <climits>
+#include <cstddef>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <thread>
@@ -20,9 +22,31 @@
 #include <ostream>
 
 // local includes
+#include "allocations.h"
+#include "assets.h"
+#include "asteroids.h"
+#include "bodies.h"
+#include "broadphase.h"
 #include "camera.h"
+#include "catalog.h"
+#include "clock.h"
+#include "ephemeris.h"
+#include "frustum.h"
+#include "gpucull.h"
+#include "kepler.h"
+#include "minorplanets.h"
+#include "nbody.h"
+#include "orbitpaths.h"
+#include "parallel.h"
+#include "renderqueue.h"
+#include "replay.h"
+#include "scene.h"
+#include "snapshot.h"
+#include "stream.h"
+#include "warp.h"
 #include "model.h"
 #include "shader.h"
+#include "uniformblocks.h"
 
 // imgui
 #include "imgui.h"
@@ -53,7 +77,12 @@ bool keys[1024];
 GLfloat lastX = 400, lastY = 300;
 float zNear = 0.1f, zFar = 4500.0f;
 bool firstMouse = true;
-string cameraType = "";
+// catalog index of the planet the camera follows, or one of these
+const int CAMERA_FREE = -1;
+const int CAMERA_UP = -2;
+int cameraTarget = CAMERA_FREE;
+// planets in the catalog, for the number keys
+int planetCount = 0;
 float volume = 0.5f;
 
 // Light attributes
@@ -68,12 +97,40 @@ GLfloat AU = 149.597870f; // dividido por 10^6
 GLfloat speed = 0.0000001;
 GLfloat outerSpeed = 0.0001;
 
+// Orbit and spin speeds above are in degrees per tick. A tick used to be one
+// rendered frame, now it is a fixed slice of simulation time and the clock
+// runs this many of them per real second at speed 1
+const double TICKS_PER_SECOND = 60.0;
+// Ticks per fixed simulation step. Planets are closed form in time, the step
+// only paces what is integrated (the asteroid belt, about 2500 steps a lap)
+const double SIM_STEP = 256.0;
+// Earth years of planet positions tabulated ahead, about half an hour at the
+// top of the speed slider
+const double EPHEMERIS_YEARS = 1000.0;
+// the asteroid field is the same on every run, and the headless default
+const unsigned int ASTEROID_SEED = 0;
+
 bool menuActive;
 bool bloomActive = true;
 bool lensFlareActive = true;
 bool showPlanetLabels = false;
 bool showPlanetTrajectories = true;
 bool shouldSkip = false;
+bool asteroidGravity = false;
+bool showMinorPlanets = false;
+// the Keplerian belt moved and culled on the GPU instead of streamed every
+// frame
+bool beltOnGpu = false;
+
+// the menu toggles, as a replay records them
+uint32_t replayToggles() {
+  return (showPlanetTrajectories ? REPLAY_TRAJECTORIES : 0) |
+         (showPlanetLabels ? REPLAY_LABELS : 0) |
+         (lensFlareActive ? REPLAY_LENS_FLARE : 0) |
+         (bloomActive ? REPLAY_BLOOM : 0) |
+         (asteroidGravity ? REPLAY_ASTEROID_GRAVITY : 0) |
+         (showMinorPlanets ? REPLAY_MINOR_PLANETS : 0);
+}
 
 const double cooldownDuration = 0.5;
 static double lastKeyPressTime = 0.0;
@@ -88,16 +145,24 @@ ImGuiWindowFlags label_window_decorations =
 const char *songs[] = {"resources/others/1.mp3", "resources/others/2.mp3",
                        "resources/others/3.mp3"};
 
-std::vector<glm::vec3> orbitCircle(float radius, int segments,
-                                   const glm::vec3 &center) {
-  std::vector<glm::vec3> circlePoints;
-  for (int i = 0; i < segments; i++) {
-    float theta = 2.0f * PI * float(i) / float(segments);
-    float x = center.x + radius * sin(theta);
-    float z = center.z + radius * cos(theta);
-    circlePoints.push_back(glm::vec3(x, center.y, z));
-  }
-  return circlePoints;
+// the Minor Planet Center's orbit catalog, not shipped with the repository
+const char *MINOR_PLANET_CATALOG = "resources/others/MPCORB.DAT";
+// minor planets closer than this to the camera are drawn as rocks, up to
+// MINOR_PLANET_ROCKS of them, the rest as points
+const float MINOR_PLANET_NEAR = 30.0f;
+const unsigned int MINOR_PLANET_ROCKS = 20000;
+
+// where the simulation is saved when no --resume file was given
+const char *SNAPSHOT_PATH = "resources/snapshot.bin";
+
+// The orbit engine works in the ecliptic frame (z up, AU), the scene is y up
+// and scaled by AU
+glm::vec3 eclipticToWorld(float x, float y, float z) {
+  return glm::vec3(x, z, -y) * (AU * scale);
+}
+
+glm::vec3 worldToEcliptic(glm::vec3 pos) {
+  return glm::vec3(pos.x, -pos.z, pos.y) / (AU * scale);
 }
 
 struct Sphere {
@@ -112,22 +177,37 @@ Sphere createSphere(float radius, glm::vec3 position) {
   return sphere;
 }
 
-void draw_moon(glm::vec3 pos, Model moon, float moonOrbitRadius,
-               float moonOrbitSpeed, Shader shader) {
-  GLfloat radius = AU * moonOrbitRadius;
-  glm::mat4 moonModel = glm::mat4(1.0f);
-  moonModel = glm::translate(moonModel, pos + glm::vec3(radius, 0.0f, radius));
-  moonModel = glm::scale(moonModel, glm::vec3(0.6f, 0.6f, 0.6f));
-
-  shader.use();
-  shader.setMat4("model", moonModel);
-  moon.Draw(shader);
+// how far a level of detail may stray from the full mesh on screen
+const float LOD_TOLERANCE_PIXELS = 1.0f;
+
+// queues every mesh of a model, materials holds one per mesh. They are all
+// culled by the sphere around the whole model. levels holds the level of
+// detail each mesh was drawn at last time, and is updated for this one
+void submit_model(RenderQueue &queue, const Model &body,
+                  const std::vector<size_t> &materials,
+                  std::vector<size_t> &levels, const glm::mat4 &model) {
+  float stretch = std::max(glm::length(glm::vec3(model[0])),
+                           std::max(glm::length(glm::vec3(model[1])),
+                                    glm::length(glm::vec3(model[2]))));
+  Sphere bounds = createSphere(body.radius * stretch, glm::vec3(model[3]));
+  float depth = glm::length(bounds.center - camera.Position);
+  // screen pixels a model unit covers at the body's distance
+  float pixels = SCREEN_HEIGHT /
+                 (2.0f * tan(glm::radians(camera.Zoom) * 0.5f)) * stretch /
+                 std::max(depth, zNear);
+  levels.resize(body.meshes.size(), 0);
+  for (size_t i = 0; i < body.meshes.size(); i++) {
+    const Mesh &mesh = body.meshes[i];
+    levels[i] = mesh.selectLod(pixels, LOD_TOLERANCE_PIXELS, levels[i]);
+    queue.submit(RenderQueue::OPAQUE_PASS, materials[i], mesh, levels[i],
+                 model, depth, bounds.center, bounds.radius);
+  }
 }
 
-void showLabel(GLfloat x, GLfloat y, string name, glm::mat4 projection,
+void showLabel(glm::vec3 pos, string name, glm::mat4 projection,
                glm::mat4 view) {
   glm::mat4 vp = projection * view;
-  glm::vec4 clipCoords = vp * glm::vec4(x, 0, y, 1.0);
+  glm::vec4 clipCoords = vp * glm::vec4(pos, 1.0);
   clipCoords /= clipCoords.w;
 
   int div = (((float)SCREEN_HEIGHT / SCREEN_WIDTH) == 1.6f) ? 2 : 1;
@@ -151,127 +231,57 @@ void showLabel(GLfloat x, GLfloat y, string name, glm::mat4 projection,
   }
 }
 
-// Radiuses are in astronomical units
-// Rotation speeds are in Km/s
-void draw_planet(bool move, int i, glm::mat4 view, glm::mat4 projection,
-                 float outerRadius, float innerRadius, float outerRotationSpeed,
-                 float innerRotationSpeed, float innerYaw, string name,
-                 Shader shader, Shader pathShader, Model planet,
-                 Sphere *sphere = NULL, Model *moon = NULL,
-                 Shader *shader2 = NULL, unsigned int nightTextureID = 0,
-                 unsigned int cloudTextureID = 0) {
-  GLfloat angle, radius, x, y;
-  GLuint vbo, vao;
-  glm::mat4 model(1);
-  glm::vec3 pos(0);
-
-  glGenBuffers(1, &vbo);
-  glGenVertexArrays(1, &vao);
-  glBindVertexArray(vao);
-
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+// body is the planet's index in the catalog
+// orbitNode is where the orbit engine put the body at this frame, bodyNode
+// its spinning model, queued with a material per mesh
+void draw_planet(bool move, glm::mat4 view, glm::mat4 projection,
+                 const BodyCatalog &catalog, size_t body,
+                 const SceneGraph &scene, SceneGraph::Node orbitNode,
+                 SceneGraph::Node bodyNode, RenderQueue &queue,
+                 const Model &planet, const std::vector<size_t> &materials,
+                 std::vector<size_t> &levels, Sphere *sphere = NULL) {
+  GLfloat x = 0.0f, y = 0.0f;
+  glm::vec3 pos = scene.worldPosition(orbitNode);
 
   // Rotation around the sun
   if (move) {
-    angle = outerRotationSpeed * i;
-    radius = outerRadius * AU * scale;
-    x = radius * sin(PI * 2 * angle / 360);
-    y = radius * cos(PI * 2 * angle / 360);
-    model = glm::translate(model, glm::vec3(x, 0.0f, y));
-    pos = glm::vec3(x, 0.0f, y);
+    x = pos.x;
+    y = pos.z;
 
     if (sphere != NULL)
-      sphere->center = glm::vec3(x, 0.0f, y);
-
-    glm::vec3 pathColor = glm::vec3(0.15f, 0.15f, 0.15f);
-    pathShader.use();
-    pathShader.setVec3("pathColor", pathColor);
-
-    if (showPlanetTrajectories) {
-      int segments = 100;
-      std::vector<glm::vec3> circlePoints =
-          orbitCircle(radius, segments, lightPos);
-
-      glBufferData(GL_ARRAY_BUFFER, circlePoints.size() * sizeof(glm::vec3),
-                   &circlePoints[0], GL_STATIC_DRAW);
-
-      glEnableVertexAttribArray(0);
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
-                            (void *)0);
-
-      pathShader.use();
-      pathShader.setMat4("model", glm::mat4(1.0f));
-      glDrawArrays(GL_LINE_LOOP, 0, circlePoints.size());
-
-      glDeleteBuffers(1, &vbo);
-      glDeleteVertexArrays(1, &vao);
-    }
-
-    shader.use();
-    shader.setMat4("model", glm::mat4(1.0f));
-
-    glBindVertexArray(0);
-  } else {
-    model = glm::translate(model, glm::vec3(outerRadius * scale, 0.0f, 0.0f));
+      sphere->center = pos;
   }
 
-  if (cameraType == name) {
-    if (name == "Mercury" || name == "Venus" || name == "Earth" ||
-        name == "Mars" || name == "Neptune") {
-      camera.Position =
-          (glm::vec3(x + outerRadius + 2.5f, 0.0f, y + outerRadius / 2 + 2.5f));
-    }
-    if (name == "Jupiter" || name == "Saturn") {
-      camera.Position = (glm::vec3(x + outerRadius + 35.0f, 0.0f,
-                                   y + outerRadius / 2 + 35.0f));
-    }
-    if (name == "Uranus") {
-      camera.Position = (glm::vec3(x + outerRadius + 10.0f, 0.0f,
-                                   y + outerRadius / 2 + 10.0f));
-    }
+  if (cameraTarget == (int)body) {
+    float outerRadius = catalog.a[body];
+    float offset = catalog.cameraOffset[body];
+    camera.Position = (glm::vec3(x + outerRadius + offset, pos.y,
+                                 y + outerRadius / 2 + offset));
   }
 
-  // Inner rotation
-  angle = innerRotationSpeed * i * 1.35;
-  model = glm::rotate(model, innerYaw + angle, glm::vec3(0.0f, 0.1f, 0.0f));
-  model = glm::scale(model, glm::vec3(innerRadius * scale));
-  shader.setMat4("model", model);
-
   if (showPlanetLabels)
-    showLabel(x, y, name, projection, view);
+    showLabel(pos, catalog.name[body], projection, view);
 
-  if (name == "Earth") {
-    planet.Draw2(shader, "night", nightTextureID, "cloud", cloudTextureID,
-                 glfwGetTime());
-
-    draw_moon(glm::vec3(x, 0.0f, y), *moon, 0.035f, 0.002f, *shader2);
-    return;
-  }
-
-  planet.Draw(shader);
-  return;
+  submit_model(queue, planet, materials, levels, scene.world(bodyNode));
 }
 
-void DisplayPlanetInfo(const char *planetName, const char *menuTitle,
-                       const char *mass, const char *volume,
-                       const char *surfaceArea, const char *gravity,
-                       const char *distanceToSun, const char *dayDuration,
-                       const char *yearDuration,
-                       const std::vector<std::pair<const char *, const char *>>
-                           &atmosphereComposition) {
-  if (ImGui::Begin(menuTitle)) {
+void DisplayPlanetInfo(const BodyCatalog &catalog, size_t body) {
+  std::string menuTitle = catalog.name[body] + " Menu";
+  if (ImGui::Begin(menuTitle.c_str())) {
     ImGui::TextColored(ImVec4(1, 1, 0, 1), "Características:");
-    ImGui::Text("Massa: %s", mass);
-    ImGui::Text("Volume: %s", volume);
-    ImGui::Text("Área da Superfície: %s", surfaceArea);
-    ImGui::Text("Gravidade à Superfície: %s", gravity);
-    ImGui::Text("Distancia ao sol: %s", distanceToSun);
-    ImGui::Text("Duração de um dia: %s", dayDuration);
-    ImGui::Text("Duração de um ano: %s", yearDuration);
+    ImGui::Text("Massa: %s", catalog.mass[body].c_str());
+    ImGui::Text("Volume: %s", catalog.volume[body].c_str());
+    ImGui::Text("Área da Superfície: %s", catalog.surfaceArea[body].c_str());
+    ImGui::Text("Gravidade à Superfície: %s", catalog.gravity[body].c_str());
+    ImGui::Text("Distancia ao sol: %s", catalog.distanceToSun[body].c_str());
+    ImGui::Text("Duração de um dia: %s", catalog.day[body].c_str());
+    ImGui::Text("Duração de um ano: %s", catalog.year[body].c_str());
     ImGui::TextColored(ImVec4(1, 1, 0, 1), "Composição da Atmosfera:");
 
-    for (const auto &component : atmosphereComposition) {
-      ImGui::Text("%s: %s%%", component.first, component.second);
+    for (uint32_t i = catalog.atmosphere[body];
+         i < catalog.atmosphere[body + 1]; i++) {
+      ImGui::Text("%s: %s%%", catalog.gas[i].c_str(),
+                  catalog.gasFraction[i].c_str());
     }
 
     ImGui::End();
@@ -303,8 +313,20 @@ bool isIntersecting(glm::vec3 rayOrigin, glm::vec3 rayDirection,
   return false;
 }
 
-int system() {
+int system(const char *recordPath, const char *replayPath,
+           const char *resumePath) {
   bool move = true;
+  // a replay brings its own asteroid field and frames
+  ReplayPlayer player;
+  bool replaying = replayPath != NULL;
+  if (replaying && !player.open(replayPath))
+    return EXIT_FAILURE;
+  // and so does a snapshot, along with everything else
+  Snapshot snapshot;
+  bool resuming =
+      !replaying && resumePath != NULL && snapshot.open(resumePath);
+  const char *snapshotPath = resumePath != NULL ? resumePath : SNAPSHOT_PATH;
+
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -363,170 +385,358 @@ int system() {
           "Trajetoria dos Planetas"
        << endl;
 
-  Shader shader("resources/shaders/modelLoading.vs",
-                "resources/shaders/modelLoading.frag");
-  Shader earthShader("resources/shaders/earth.vs",
-                     "resources/shaders/earth.frag");
-  Shader pathShader("resources/shaders/path.vs", "resources/shaders/path.frag");
-  Shader skyboxShader("resources/shaders/skybox.vs",
-                      "resources/shaders/skybox.frag");
-  Shader lampShader("resources/shaders/lamp.vs", "resources/shaders/lamp.frag");
-  Shader screenShader("resources/shaders/framebuffer.vs",
-                      "resources/shaders/framebuffer.frag");
-  Shader blurShader("resources/shaders/blur.vs", "resources/shaders/blur.frag");
-  Shader asteroidShader("resources/shaders/asteroids.vs",
-                        "resources/shaders/modelLoading.frag");
+  // models, textures and programs are loaded once into the registry and
+  // used by reference from then on
+  AssetRegistry assets;
+  Shader &shader = assets[assets.shader("resources/shaders/modelLoading.vs",
+                                        "resources/shaders/modelLoading.frag")];
+  Shader &earthShader = assets[assets.shader("resources/shaders/earth.vs",
+                                             "resources/shaders/earth.frag")];
+  Shader &pathShader = assets[assets.shader("resources/shaders/path.vs",
+                                            "resources/shaders/path.frag")];
+  Shader &skyboxShader = assets[assets.shader(
+      "resources/shaders/skybox.vs", "resources/shaders/skybox.frag")];
+  Shader &lampShader = assets[assets.shader("resources/shaders/lamp.vs",
+                                            "resources/shaders/lamp.frag")];
+  Shader &screenShader =
+      assets[assets.shader("resources/shaders/framebuffer.vs",
+                           "resources/shaders/framebuffer.frag")];
+  Shader &blurShader = assets[assets.shader("resources/shaders/blur.vs",
+                                            "resources/shaders/blur.frag")];
+  Shader &asteroidShader = assets[assets.shader(
+      "resources/shaders/asteroids.vs", "resources/shaders/modelLoading.frag")];
+  Shader &pointShader = assets[assets.shader("resources/shaders/points.vs",
+                                             "resources/shaders/points.frag")];
+  Shader &cullShader = assets[assets.feedbackShader(
+      "resources/shaders/beltCull.vs", "resources/shaders/beltCull.gs",
+      std::vector<std::string>(1, "instanceMatrix"))];
+
+  // Everything about the planets and their moons comes from the catalog
+  BodyCatalog catalog;
+  if (!loadCatalog(catalog, "resources/bodies.json",
+                   "resources/bodies.cache")) {
+    assets.release();
+    glfwTerminate();
+    return EXIT_FAILURE;
+  }
+  planetCount = (int)catalog.size();
 
   float sunRadius = 50.0f;
-  float earthRadius = 1.5f;
-  float mercuryRadius = 0.35f;
-  float venusRadius = 1.0f;
-  float marsRadius = 0.9f;
-  float jupiterRadius = 15.0f;
-  float saturnRadius = 12.0f;
-  float uranusRadius = 10.0f;
-  float neptuneRadius = 10.0f;
   // Load models
-  Model earthModel("resources/models/earth/earth.obj");
-  Model sunModel("resources/models/sun/sun.obj");
-  Model mercuryModel("resources/models/mercury/mercury.obj");
-  Model venusModel("resources/models/venus/venus.obj");
-  Model marsModel("resources/models/mars/mars.obj");
-  Model jupiterModel("resources/models/jupiter/jupiter.obj");
-  Model saturnModel("resources/models/saturn/saturn.obj");
-  Model uranusModel("resources/models/uranus/uranus.obj");
-  Model neptuneModel("resources/models/neptune/neptune.obj");
-  Model moonModel("resources/models/moon/moon.obj");
-  Model asteroidModel("resources/models/asteroid/rock.obj");
+  Model &sunModel = assets[assets.model("resources/models/sun/sun.obj")];
+  Model &asteroidModel =
+      assets[assets.model("resources/models/asteroid/rock.obj")];
+  std::vector<ModelHandle> planetModels;
+  for (size_t k = 0; k < catalog.size(); k++)
+    planetModels.push_back(assets.model(catalog.model[k]));
+  // moons mostly share a model, the registry loads each file once
+  std::vector<ModelHandle> moonModels;
+  for (size_t m = 0; m < catalog.moonCount(); m++)
+    moonModels.push_back(assets.model(catalog.moonModel[m]));
 
   // Spheres for ray cast collisions
   Sphere sunSphere = createSphere(sunRadius, lightPos);
-  Sphere earthSphere =
-      createSphere(earthRadius, glm::vec3(0.0f, 0.0f, 1.0f * AU));
-  Sphere mercurySphere =
-      createSphere(mercuryRadius, glm::vec3(0.0f, 0.0f, 0.39f * AU));
-  Sphere venusSphere =
-      createSphere(venusRadius, glm::vec3(0.0f, 0.0f, 0.72f * AU));
-  Sphere marsSphere =
-      createSphere(marsRadius, glm::vec3(0.0f, 0.0f, 1.52f * AU));
-  Sphere jupiterSphere =
-      createSphere(jupiterRadius, glm::vec3(0.0f, 0.0f, 5.2f * AU));
-  Sphere saturnSphere =
-      createSphere(saturnRadius, glm::vec3(0.0f, 0.0f, 9.54f * AU));
-  Sphere uranusSphere =
-      createSphere(jupiterRadius, glm::vec3(0.0f, 0.0f, 14.22f * AU));
-  Sphere neptuneSphere =
-      createSphere(jupiterRadius, glm::vec3(0.0f, 0.0f, 23.06f * AU));
-
-  unsigned int earthNightTextureID =
-      TextureFromFile("resources/models/earth/earthnight.jpg", ".");
-
-  unsigned int earthCloudTextureID =
-      TextureFromFile("resources/models/earth/earthclouds.jpg", ".");
+  std::vector<Sphere> planetSpheres;
+  for (size_t k = 0; k < catalog.size(); k++)
+    planetSpheres.push_back(createSphere(
+        catalog.radius[k], glm::vec3(0.0f, 0.0f, catalog.a[k] * AU)));
+
+  // Orbits of the planets, in the order they are drawn
+  OrbitalElements planetElements;
+  catalog.addOrbits(planetElements);
+  KeplerPropagator planetPropagator(planetElements);
+  std::vector<float> planetX(planetElements.size()),
+      planetY(planetElements.size()), planetZ(planetElements.size());
+  OrbitPaths orbitPaths;
+  // orbit path vertices drawn by the latest frame
+  size_t orbitVertices = 0;
+
+  // Earth's year sets the Sun's mass and the length of a day for the moons
+  size_t earth = std::max(catalog.find("Earth"), 0);
+  double gmSun = sunGM(planetElements, earth);
+
+  // While the simulation time is inside the precomputed table the planets are
+  // looked up there, past its end the Kepler solver takes over. The table is
+  // fitted again whenever the orbits no longer match it
+  Ephemeris ephemeris;
+  const char *ephemerisPath = "resources/ephemeris.bin";
+  if (!ephemeris.open(ephemerisPath, ephemerisSource(planetElements))) {
+    double earthYear = 2.0 * M_PI / planetElements.n[earth];
+    writeEphemeris(ephemerisPath, planetElements, 0.0,
+                   EPHEMERIS_YEARS * earthYear);
+    ephemeris.open(ephemerisPath, ephemerisSource(planetElements));
+  }
+  auto planetPositions = [&](double t) {
+    if (ephemeris.contains(t))
+      ephemeris.positions(t, planetX.data(), planetY.data(), planetZ.data());
+    else
+      planetPropagator.propagate(t, planetX.data(), planetY.data(),
+                                 planetZ.data());
+  };
+
+  ThreadPool workers;
+  NBody belt;
+  std::vector<Attractor> attractors(planetElements.size() + 1);
+  TimeWarp beltWarp;
+
+  // Transform hierarchy: every planet has an orbit node the orbit engine
+  // moves, with its spinning model and its moons' pivots under it
+  SceneGraph scene;
+  std::vector<SceneGraph::Node> orbitNode(catalog.size()),
+      bodyNode(catalog.size());
+  for (size_t k = 0; k < catalog.size(); k++) {
+    orbitNode[k] = scene.add(SceneGraph::ROOT);
+    bodyNode[k] = scene.add(orbitNode[k], glm::vec3(0.0f),
+                            glm::vec3(catalog.scale[k] * scale));
+  }
+  std::vector<SceneGraph::Node> moonPivot(catalog.moonCount()),
+      moonNode(catalog.moonCount());
+  for (size_t m = 0; m < catalog.moonCount(); m++) {
+    moonPivot[m] =
+        scene.add(orbitNode[catalog.moonParent[m]], glm::vec3(0.0f),
+                  glm::vec3(1.0f), catalog.moonPhase[m]);
+    moonNode[m] =
+        scene.add(moonPivot[m], glm::vec3(catalog.moonDistance[m], 0.0f, 0.0f),
+                  glm::vec3(0.6f * catalog.moonSize[m]));
+  }
+  SceneGraph::Node sunNode =
+      scene.add(SceneGraph::ROOT, lightPos, glm::vec3(scale));
+
+  // the Sun and the planets pulling on the belt at time t
+  auto beltAttractors = [&](double t) -> const std::vector<Attractor> & {
+    planetPositions(t);
+    Attractor sun = {0.0, 0.0, 0.0, gmSun};
+    attractors[0] = sun;
+    for (unsigned int k = 0; k < planetElements.size(); k++) {
+      Attractor planet = {planetX[k], planetY[k], planetZ[k],
+                          gmSun * catalog.massRatio[k]};
+      attractors[k + 1] = planet;
+    }
+    return attractors;
+  };
+
+  // night lights and clouds of the planets drawn like Earth
+  std::vector<unsigned int> nightTextureID(catalog.size(), 0),
+      cloudTextureID(catalog.size(), 0);
+  for (size_t k = 0; k < catalog.size(); k++) {
+    if (catalog.nightTexture[k].empty())
+      continue;
+    nightTextureID[k] = assets[assets.texture(catalog.nightTexture[k])];
+    cloudTextureID[k] = assets[assets.texture(catalog.cloudTexture[k])];
+  }
+
+  // Planets, moons and the Sun go through the render queue, a material for
+  // every mesh of every model
+  RenderQueue renderQueue;
+  auto modelMaterials = [&](const Model &body, Shader &program,
+                            const RenderQueue::Textures &extra) {
+    std::vector<size_t> materials;
+    for (size_t i = 0; i < body.meshes.size(); i++)
+      materials.push_back(
+          renderQueue.meshMaterial(program, body.meshes[i], extra));
+    return materials;
+  };
+  std::vector<std::vector<size_t>> planetMaterials;
+  for (size_t k = 0; k < catalog.size(); k++) {
+    RenderQueue::Textures extra;
+    if (!catalog.nightTexture[k].empty()) {
+      extra.push_back(std::make_pair("night", nightTextureID[k]));
+      extra.push_back(std::make_pair("cloud", cloudTextureID[k]));
+    }
+    planetMaterials.push_back(modelMaterials(
+        assets[planetModels[k]], extra.empty() ? shader : earthShader, extra));
+  }
+  std::vector<std::vector<size_t>> moonMaterials;
+  for (size_t m = 0; m < moonModels.size(); m++)
+    moonMaterials.push_back(modelMaterials(assets[moonModels[m]], shader,
+                                           RenderQueue::Textures()));
+  std::vector<size_t> sunMaterials =
+      modelMaterials(sunModel, lampShader, RenderQueue::Textures());
+  // the level of detail every mesh of every body was drawn at last
+  std::vector<std::vector<size_t>> planetLevels(catalog.size()),
+      moonLevels(catalog.moonCount());
+  std::vector<size_t> sunLevels;
 
   unsigned int noiseTextureID =
-      TextureFromFile("resources/models/others/noise.png", ".");
+      assets[assets.texture("resources/models/others/noise.png")];
   //    glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
 
   std::thread audioThread(&initializeMiniaudio);
 
-  // Set light properties
-  shader.use();
-  shader.setVec3("light.position", lightPos);
-  shader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-  shader.setVec3("light.diffuse", 1.5f, 1.5f, 1.5f);
-  shader.setVec3("light.specular", 0.3f, 0.3f, 0.3f);
-  shader.setFloat("light.constant", 1.5f);
-  shader.setFloat("light.linear", 0.0000002f);
-  shader.setFloat("light.quadratic", 0.0000006f);
+  // Camera and light are uniform blocks shared by every program, filled
+  // once a frame. Only the constant part of the light's attenuation differs
+  // between them
+  UniformBlocks uniformBlocks;
+  uniformBlocks.create();
+  Shader *programs[] = {&shader,     &earthShader, &pathShader, &skyboxShader,
+                        &lampShader, &asteroidShader, &pointShader,
+                        &cullShader};
+  for (size_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++)
+    uniformBlocks.attach(*programs[i]);
+  LightBlock light = LightBlock();
+  light.position = glm::vec4(lightPos, 1.0f);
+  light.ambient = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+  light.diffuse = glm::vec4(1.5f, 1.5f, 1.5f, 0.0f);
+  light.specular = glm::vec4(0.3f, 0.3f, 0.3f, 0.0f);
+  light.linear = 0.0000002f;
+  light.quadratic = 0.0000006f;
 
+  shader.use();
+  shader.setFloat("lightConstant", 1.5f);
   earthShader.use();
-  earthShader.setVec3("light.position", lightPos);
-  earthShader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-  earthShader.setVec3("light.diffuse", 1.5f, 1.5f, 1.5f);
-  earthShader.setVec3("light.specular", 0.3f, 0.3f, 0.3f);
-  earthShader.setFloat("light.constant", 1.0f);
-  earthShader.setFloat("light.linear", 0.0000002f);
-  earthShader.setFloat("light.quadratic", 0.0000006f);
-
+  earthShader.setFloat("lightConstant", 1.0f);
   asteroidShader.use();
-  asteroidShader.setVec3("light.position", lightPos);
-  asteroidShader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-  asteroidShader.setVec3("light.diffuse", 1.5f, 1.5f, 1.5f);
-  asteroidShader.setVec3("light.specular", 0.3f, 0.3f, 0.3f);
-  asteroidShader.setFloat("light.constant", 1.0f);
-  asteroidShader.setFloat("light.linear", 0.0000002f);
-  asteroidShader.setFloat("light.quadratic", 0.0000006f);
+  asteroidShader.setFloat("lightConstant", 1.0f);
 
   lampShader.use();
   lampShader.setFloat("sunIntensity", 200.5f);
 
   // GPU Instancing for the asteroids
-  unsigned int amount = 10000;
+  unsigned int amount = replaying   ? player.header.asteroids
+                        : resuming ? snapshot.state().asteroids
+                                   : 10000;
+  unsigned int asteroidSeed =
+      replaying  ? player.header.seed
+      : resuming ? snapshot.state().seed
+                 : ASTEROID_SEED;
+  AsteroidField field;
   glm::mat4 *modelMatrices;
   modelMatrices = new glm::mat4[amount];
-  srand(static_cast<unsigned int>(glfwGetTime())); // initialize random seed
-  float asteroidRadius = 3.0f * AU;
-  float offset = 0.2f * AU;
-  for (unsigned int i = 0; i < amount; i++) {
-    glm::mat4 model = glm::mat4(1.0f);
-    // 1. translation: displace along circle with 'radius' in range [-offset,
-    // offset]
-    float angle = (float)i / (float)amount * 360.0f;
-    float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-    float x = sin(angle) * asteroidRadius + displacement;
-    displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-    float y = displacement * 0.4f; // keep height of asteroid field smaller
-                                   // compared to width of x and z
-    displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-    float z = cos(angle) * asteroidRadius + displacement;
-    model = glm::translate(model, glm::vec3(x, y, z));
-
-    // 2. scale: Scale between 0.05 and 0.50f
-    float scale = static_cast<float>((rand() % 20) / 50.0 + 0.05);
-    model = glm::scale(model, glm::vec3(scale));
-
-    // 3. rotation: add random rotation around a (semi)randomly picked rotation
-    // axis vector
-    float rotAngle = static_cast<float>((rand() % 360));
-    model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
-
-    // 4. now add to list of matrices
-    modelMatrices[i] = model;
+  if (resuming) {
+    // the snapshot has the field and its matrices ready
+    snapshot.restoreField(field);
+    memcpy(&modelMatrices[0][0][0], snapshot.instances(),
+           amount * sizeof(glm::mat4));
+  } else {
+    generateAsteroidField(field, amount, asteroidSeed, workers);
+    for (unsigned int i = 0; i < amount; i++) {
+      glm::mat4 model = glm::mat4(1.0f);
+      model = glm::translate(
+          model, eclipticToWorld(field.x[i], field.y[i], field.z[i]));
+      model = glm::scale(model, glm::vec3(field.scale[i]));
+      model =
+          glm::rotate(model, field.rotation[i], glm::vec3(0.4f, 0.6f, 0.8f));
+      modelMatrices[i] = model;
+    }
   }
 
-  // configure instanced array
-  unsigned int buffer;
-  glGenBuffers(1, &buffer);
-  glBindBuffer(GL_ARRAY_BUFFER, buffer);
-  glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0],
-               GL_STATIC_DRAW);
-
-  // set transformation matrices as an instance vertex attribute
-  for (unsigned int i = 0; i < asteroidModel.meshes.size(); i++) {
-    unsigned int VAO = asteroidModel.meshes[i].VAO;
-    glBindVertexArray(VAO);
-    // set attribute pointers for matrix (4 times vec4)
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
-                          (void *)0);
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
-                          (void *)(sizeof(glm::vec4)));
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
-                          (void *)(2 * sizeof(glm::vec4)));
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
-                          (void *)(3 * sizeof(glm::vec4)));
-
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-    glVertexAttribDivisor(6, 1);
+  // collision spheres of the asteroids, in AU. The rock model reaches 2.14
+  // units from its centre at scale 1
+  std::vector<float> asteroidRadius(amount);
+  for (unsigned int i = 0; i < amount; i++)
+    asteroidRadius[i] = field.scale[i] * 2.14f / AU;
+  Broadphase broadphase;
+
+  // The belt goes round the Sun on its Keplerian orbits, or under gravity.
+  // Every frame its instance matrices are worked out on worker threads while
+  // the rest of the scene is drawn, straight into a region of the instance
+  // stream the GPU is done with. The stream carries the rocks of the minor
+  // planet catalog too
+  OrbitalElements beltOrbits;
+  KeplerPropagator beltPropagator;
+  beltElements(beltOrbits, field, gmSun);
+  beltPropagator.setElements(beltOrbits);
+  std::vector<float> beltX(amount), beltY(amount), beltZ(amount);
+  BackgroundJob beltJob;
+  // Rocks out of view are left out of the stream. The job culls the belt a
+  // block at a time, then packs the visible rocks of every block right after
+  // those of the blocks before it
+  const size_t BELT_BLOCKS = 64;
+  std::vector<uint8_t> beltVisible(amount);
+  std::vector<size_t> beltBlockStart(BELT_BLOCKS + 1);
+  size_t beltInstances = amount;
+  InstanceStream instanceStream;
+  unsigned int instanceCapacity = std::max(amount, MINOR_PLANET_ROCKS);
+  instanceStream.create(instanceCapacity, sizeof(glm::mat4));
+
+  // Or the GPU moves the belt itself from the orbits in a static buffer,
+  // which costs the CPU nothing a frame: a transform feedback pass turns the
+  // orbits into instance matrices, keeping only the rocks in view, and the
+  // draw reads those. Float time since the epoch of the buffer runs out of
+  // precision, so it is packed again for a new epoch once the fastest rock
+  // has gone round too many times since
+  const double ORBIT_EPOCH_LAPS = 64.0;
+  std::vector<OrbitInstance> orbitData(amount);
+  GLuint orbitVBO;
+  glGenBuffers(1, &orbitVBO);
+  double orbitEpoch = 0.0;
+  bool orbitStale = true;
+  double fastestOrbit = 0.0;
+  for (unsigned int i = 0; i < amount; i++)
+    fastestOrbit = std::max(fastestOrbit, fabs(beltOrbits.n[i]));
+  auto packOrbits = [&](double epoch) {
+    workers.parallelFor(amount, [&](size_t begin, size_t end) {
+      orbitInstances(beltOrbits, field, asteroidSeed, epoch, begin, end,
+                     orbitData.data());
+    });
+    glBindBuffer(GL_ARRAY_BUFFER, orbitVBO);
+    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(OrbitInstance),
+                 orbitData.data(), GL_STATIC_DRAW);
+    orbitEpoch = epoch;
+    orbitStale = false;
+  };
+  GpuCuller beltCuller;
+  beltCuller.create(amount, sizeof(glm::mat4));
+  glBindVertexArray(beltCuller.vertexArray());
+  glBindBuffer(GL_ARRAY_BUFFER, orbitVBO);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(OrbitInstance),
+                        (void *)offsetof(OrbitInstance, a));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_SHORT, GL_FALSE, sizeof(OrbitInstance),
+                        (void *)offsetof(OrbitInstance, q));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 4, GL_SHORT, GL_FALSE, sizeof(OrbitInstance),
+                        (void *)offsetof(OrbitInstance, scale));
+  glBindVertexArray(0);
+  Uniform<glm::vec4> cullPlanes[6];
+  for (int k = 0; k < 6; k++)
+    cullPlanes[k] =
+        cullShader.uniform<glm::vec4>("planes[" + std::to_string(k) + "]");
+  // rocks farther than this are not drawn, world units
+  float beltCutoff = zFar;
+
+  // set transformation matrices as an instance vertex attribute, starting
+  // offset bytes into buffer
+  auto pointInstances = [&](GLuint buffer, size_t offset) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (unsigned int i = 0; i < asteroidModel.meshes.size(); i++) {
+      unsigned int VAO = asteroidModel.meshes[i].VAO;
+      glBindVertexArray(VAO);
+      // set attribute pointers for matrix (4 times vec4)
+      for (unsigned int c = 0; c < 4; c++) {
+        glEnableVertexAttribArray(3 + c);
+        glVertexAttribPointer(3 + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void *)(offset + c * sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + c, 1);
+      }
+      glBindVertexArray(0);
+    }
+  };
 
-    glBindVertexArray(0);
-  }
+  // Minor planet catalog, streamed from disk once turned on. Every body is a
+  // point, the ones near the camera also get a rock from the instanced
+  // asteroid path, in place of the belt
+  MinorPlanetLoader minorPlanetLoader;
+  MinorPlanets minorPlanets;
+  KeplerPropagator minorPropagator;
+  std::vector<float> minorX, minorY, minorZ;
+  bool minorPlanetsMissing = false;
+  // Earth's mean motion in the scene (radians per tick) over the real one
+  // (radians per day)
+  double daysPerTick = planetElements.n[earth] / (2.0 * PI / 365.256363);
+
+  // bodies within reach of the camera, found a block of the catalog at a time
+  const size_t MINOR_PLANET_BLOCKS = 64;
+  std::vector<std::vector<uint32_t>> nearbyMinorPlanets(MINOR_PLANET_BLOCKS);
+  std::vector<glm::mat4> rockMatrices(MINOR_PLANET_ROCKS);
+  unsigned int rockCount = 0;
+
+  // positions for the points, x then y then z, pointCapacity floats each
+  unsigned int pointVAO, pointVBO;
+  size_t pointCapacity = 0;
+  glGenVertexArrays(1, &pointVAO);
+  glGenBuffers(1, &pointVBO);
 
   float skyboxVertices[] = {
       // positions
@@ -675,12 +885,111 @@ int system() {
   float fpsDeltaTime = 0;
 
   unsigned int cubemapTexture = loadCubemap(faces);
-  GLuint i = 0;
   int speedModifier = 1;
+  double ticksPerSecond =
+      replaying ? player.header.ticksPerSecond : TICKS_PER_SECOND;
+  SimClock simClock(replaying ? player.header.step : SIM_STEP,
+                    ticksPerSecond);
+
+  ReplayRecorder recorder;
+  if (recordPath != NULL) {
+    ReplayHeader header = {asteroidSeed, amount, simClock.step,
+                           ticksPerSecond};
+    recorder.open(recordPath, header);
+  }
+  ReplayFrame replayFrame;
+  // replayed frames whose simulation time differs from the recorded one
+  size_t replayMismatches = 0;
+
+  auto setAsteroidGravity = [&](bool on) {
+    if (on && !asteroidGravity) {
+      startBelt(belt, field, gmSun);
+      beltWarp.start(belt, gmSun, simClock.time);
+    }
+    asteroidGravity = on;
+  };
+  auto setMinorPlanets = [&](bool on) {
+    if (on && minorPlanets.size() == 0 && !minorPlanetLoader.loading())
+      minorPlanetsMissing =
+          !minorPlanetLoader.start(MINOR_PLANET_CATALOG, daysPerTick);
+    showMinorPlanets = on;
+  };
+
+  auto saveSnapshot = [&]() {
+    SnapshotHeader state = {};
+    state.seed = asteroidSeed;
+    state.toggles = replayToggles();
+    state.speedModifier = speedModifier;
+    state.cameraTarget = cameraTarget;
+    state.time = simClock.time;
+    state.previous = simClock.previous;
+    state.beltTime = beltWarp.time;
+    state.position[0] = camera.Position.x;
+    state.position[1] = camera.Position.y;
+    state.position[2] = camera.Position.z;
+    state.yaw = camera.Yaw;
+    state.pitch = camera.Pitch;
+    state.zoom = camera.Zoom;
+    writeSnapshot(snapshotPath, state, field, &modelMatrices[0][0][0],
+                  asteroidGravity ? belt : NBody());
+  };
+  // everything but the field and its matrices, which are restored with the
+  // buffers they live in
+  auto restoreSnapshot = [&](const Snapshot &saved) {
+    const SnapshotHeader &state = saved.state();
+    simClock.reset(state.time);
+    simClock.previous = state.previous;
+    speedModifier = state.speedModifier;
+    cameraTarget = state.cameraTarget;
+    camera.Position =
+        glm::vec3(state.position[0], state.position[1], state.position[2]);
+    camera.SetOrientation(state.yaw, state.pitch);
+    camera.Zoom = state.zoom;
+    showPlanetTrajectories = state.toggles & REPLAY_TRAJECTORIES;
+    showPlanetLabels = state.toggles & REPLAY_LABELS;
+    lensFlareActive = state.toggles & REPLAY_LENS_FLARE;
+    bloomActive = state.toggles & REPLAY_BLOOM;
+    setMinorPlanets(state.toggles & REPLAY_MINOR_PLANETS);
+
+    asteroidGravity = state.belt == amount && amount > 0;
+    if (asteroidGravity) {
+      saved.restoreBelt(belt);
+      beltWarp.start(belt, gmSun, state.beltTime);
+    }
+    broadphase.reset();
+  };
+  if (resuming) {
+    restoreSnapshot(snapshot);
+    snapshot.close();
+  }
+
+  // uniform traffic of the last frame, for the menu
+  UniformCounters frameUniforms = UniformCounters();
+  size_t frameBlockUploads = 0;
+  // heap allocations of the last frame, every thread
+  size_t frameAllocations = 0, frameAllocatedBytes = 0;
+  size_t allocationsBefore = allocationCount(),
+         allocatedBefore = allocatedBytes();
+  Uniform<int> blurHorizontal = blurShader.uniform<int>("horizontal");
+
   while (!glfwWindowShouldClose(window)) {
+    frameUniforms = Shader::counters();
+    Shader::counters() = UniformCounters();
+    frameBlockUploads = uniformBlocks.uploads;
+    uniformBlocks.uploads = uniformBlocks.skipped = 0;
+    frameAllocations = allocationCount() - allocationsBefore;
+    frameAllocatedBytes = allocatedBytes() - allocatedBefore;
+    allocationsBefore = allocationCount();
+    allocatedBefore = allocatedBytes();
 
     GLfloat currentFrame = glfwGetTime();
     deltaTime = currentFrame - lastFrame;
+    // a replay runs on the recorded frame times, not the real ones
+    if (replaying) {
+      if (!player.next(replayFrame))
+        break;
+      deltaTime = replayFrame.delta;
+    }
     fpsDeltaTime = currentFrame - lastTime;
 
     lastFrame = currentFrame;
@@ -717,8 +1026,52 @@ int system() {
 
           ImGui::TextColored(ImVec4(1, 1, 0, 1), "Speeds");
 
-          ImGui::SliderInt("Rotation Speed", &speedModifier, 0, 1000);
+          ImGui::SliderInt("Rotation Speed", &speedModifier, 0, 100000, "%dx",
+                           ImGuiSliderFlags_Logarithmic);
           ImGui::SliderFloat("Camera Speed", &camera.MovementSpeed, 0.0, 500.0);
+          ImGui::Text("Simulation time: %.0f ticks", simClock.time);
+          ImGui::Text("Planets from %s",
+                      ephemeris.contains(simClock.time) ? "the ephemeris"
+                                                        : "the Kepler solver");
+          ImGui::Text("Belt %.2f ms in the background, waited %.2f ms, "
+                      "%zu GPU stalls",
+                      beltJob.jobSeconds * 1000.0,
+                      beltJob.waitSeconds * 1000.0, instanceStream.stalls);
+          // the rocks of the minor planet catalog stand in for the belt
+          bool beltShown = !showMinorPlanets || minorPlanets.size() == 0;
+          if (beltShown && beltOnGpu && !asteroidGravity)
+            ImGui::Text("%zu of %u asteroids in view, culled on the GPU, %zu "
+                        "waits for the count",
+                        beltCuller.visible(), amount, beltCuller.waits);
+          else if (beltShown)
+            ImGui::Text("%zu of %u asteroids in view, %zu culled (%s)",
+                        beltInstances, amount, amount - beltInstances,
+                        cullKernelName());
+          ImGui::Text("%zu triangles, %zu at full detail",
+                      renderQueue.counters.triangles,
+                      renderQueue.unsorted.triangles);
+          ImGui::Text("%zu draws, %zu culled, %zu programs (%zu unsorted), "
+                      "%zu textures (%zu), %zu meshes (%zu)",
+                      renderQueue.counters.draws, renderQueue.counters.culled,
+                      renderQueue.counters.programs,
+                      renderQueue.unsorted.programs,
+                      renderQueue.counters.textures,
+                      renderQueue.unsorted.textures,
+                      renderQueue.counters.vertexArrays,
+                      renderQueue.unsorted.vertexArrays);
+          ImGui::Text("%zu uniforms uploaded, %zu unchanged skipped, %zu "
+                      "lookups off GL, %zu uniform blocks",
+                      frameUniforms.uploads, frameUniforms.skipped,
+                      frameUniforms.lookups, frameBlockUploads);
+          ImGui::Text("%zu allocations, %.1f KB last frame", frameAllocations,
+                      frameAllocatedBytes / 1024.0);
+          if (replaying)
+            ImGui::Text("Replaying frame %zu, %.0f%% played, %zu off",
+                        player.frameCount(), player.progress() * 100.0f,
+                        replayMismatches);
+          else if (recorder.isOpen())
+            ImGui::Text("Recording frame %zu, %.1f KB", recorder.frameCount(),
+                        recorder.size() / 1024.0);
 
           ImGui::Separator();
           ImGui::TextColored(ImVec4(1, 1, 0, 1), "Others");
@@ -726,6 +1079,11 @@ int system() {
           if (ImGui::Button("Planet Trajectory")) {
             showPlanetTrajectories = !showPlanetTrajectories;
           }
+          if (showPlanetTrajectories) {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(0.5, 0.5, 0.5, 1), "%zu vertices",
+                               orbitVertices);
+          }
 
           if (ImGui::Button("Planet Labels")) {
             showPlanetLabels = !showPlanetLabels;
@@ -738,8 +1096,77 @@ int system() {
             bloomActive = !bloomActive;
           }
 
+          if (ImGui::Button("Asteroid Gravity")) {
+            setAsteroidGravity(!asteroidGravity);
+          }
+          if (asteroidGravity) {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(0.5, 0.5, 0.5, 1),
+                               "tree %.1f ms, forces %.1f ms, %s",
+                               belt.buildSeconds * 1000.0,
+                               belt.forceSeconds * 1000.0,
+                               beltWarp.jumped ? "orbits jumped" : "stepped");
+            ImGui::TextColored(ImVec4(0.5, 0.5, 0.5, 1),
+                               "%zu asteroids touching, broadphase %.2f ms",
+                               broadphase.contacts.size(),
+                               (broadphase.sortSeconds +
+                                broadphase.sweepSeconds) *
+                                   1000.0);
+          }
+
+          if (ImGui::Button("Belt on GPU")) {
+            beltOnGpu = !beltOnGpu;
+          }
+          if (beltOnGpu) {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(0.5, 0.5, 0.5, 1), "%s",
+                               asteroidGravity
+                                   ? "not under gravity, streamed instead"
+                                   : "moved and culled by transform "
+                                     "feedback");
+            ImGui::SliderFloat("Belt Draw Distance", &beltCutoff, 50.0f, zFar,
+                               "%.0f", ImGuiSliderFlags_Logarithmic);
+          }
+
+          if (ImGui::Button("Minor Planets")) {
+            setMinorPlanets(!showMinorPlanets);
+          }
+          if (showMinorPlanets) {
+            ImGui::SameLine();
+            if (minorPlanetsMissing)
+              ImGui::TextColored(ImVec4(0.5, 0.5, 0.5, 1), "%s not found",
+                                 MINOR_PLANET_CATALOG);
+            else
+              ImGui::TextColored(ImVec4(0.5, 0.5, 0.5, 1),
+                                 "%zu bodies, %.0f%% read, %u rocks",
+                                 minorPlanets.size(),
+                                 minorPlanetLoader.progress() * 100.0f,
+                                 rockCount);
+          }
+
           ImGui::SliderInt("Blur Passes", &blurPasses, 1, 10);
 
+          ImGui::Separator();
+          if (ImGui::Button("Save Snapshot")) {
+            saveSnapshot();
+          }
+          ImGui::SameLine();
+          if (ImGui::Button("Restore Snapshot")) {
+            Snapshot saved;
+            if (saved.open(snapshotPath) && saved.state().asteroids == amount) {
+              saved.restoreField(field);
+              memcpy(&modelMatrices[0][0][0], saved.instances(),
+                     amount * sizeof(glm::mat4));
+              for (unsigned int i = 0; i < amount; i++)
+                asteroidRadius[i] = field.scale[i] * 2.14f / AU;
+              beltElements(beltOrbits, field, gmSun);
+              beltPropagator.setElements(beltOrbits);
+              orbitStale = true;
+              asteroidSeed = saved.state().seed;
+              restoreSnapshot(saved);
+            }
+          }
+
           ImGui::EndTabItem();
         }
 
@@ -747,42 +1174,19 @@ int system() {
 
           ImGui::TextColored(ImVec4(1, 1, 0, 1), "Planet Cameras");
 
-          if (ImGui::Button("Mercury")) {
-            cameraType = "Mercury";
-          }
-          ImGui::SameLine();
-          if (ImGui::Button("Venus")) {
-            cameraType = "Venus";
-          }
-          ImGui::SameLine();
-          if (ImGui::Button("Earth")) {
-            cameraType = "Earth";
-          }
-          ImGui::SameLine();
-          if (ImGui::Button("Mars")) {
-            cameraType = "Mars";
-          }
-          if (ImGui::Button("Jupiter")) {
-            cameraType = "Jupiter";
-          }
-          ImGui::SameLine();
-          if (ImGui::Button("Saturn")) {
-            cameraType = "Saturn";
-          }
-          ImGui::SameLine();
-          if (ImGui::Button("Uranus")) {
-            cameraType = "Uranus";
-          }
-          ImGui::SameLine();
-          if (ImGui::Button("Neptune")) {
-            cameraType = "Neptune";
+          for (size_t k = 0; k < catalog.size(); k++) {
+            if (k % 4 != 0)
+              ImGui::SameLine();
+            if (ImGui::Button(catalog.name[k].c_str())) {
+              cameraTarget = (int)k;
+            }
           }
 
           ImGui::Separator();
           ImGui::TextColored(ImVec4(1, 1, 0, 1), "Other Cameras");
 
           if (ImGui::Button("Up")) {
-            cameraType = "Up";
+            cameraTarget = CAMERA_UP;
           }
 
           ImGui::EndTabItem();
@@ -807,115 +1211,139 @@ int system() {
       ImGui::End();
     }
 
-    if (cameraType == "Mercury") { // FEITO
-      DisplayPlanetInfo("Mercury", "Mercury Menu", "3,3011x10^23 kg",
-                        "6,083x10^10 km³", "7,48x10^7 km²", "3,7 m/s2",
-                        "69.816.900 km", "59 horas", "88 dias",
-                        {{"Potássio", "31,7"},
-                         {"Sódio", "24,9"},
-                         {"Oxigénio Atómico", "9,5"},
-                         {"Argônio", "7,0"},
-                         {"Hélio", "5,9"},
-                         {"Oxigénio Molecular", "5,6"},
-                         {"Nitrogênio", "5,2"},
-                         {"Dióxido de carbono", "3,6"},
-                         {"Água", "3,4"},
-                         {"Hidrogénio", "3,2"}});
+    // the recorded settings win over the menu and the keys
+    if (replaying) {
+      speedModifier = replayFrame.speedModifier;
+      cameraTarget = replayFrame.cameraTarget;
+      showPlanetTrajectories = replayFrame.toggles & REPLAY_TRAJECTORIES;
+      showPlanetLabels = replayFrame.toggles & REPLAY_LABELS;
+      lensFlareActive = replayFrame.toggles & REPLAY_LENS_FLARE;
+      bloomActive = replayFrame.toggles & REPLAY_BLOOM;
+      setAsteroidGravity(replayFrame.toggles & REPLAY_ASTEROID_GRAVITY);
+      setMinorPlanets(replayFrame.toggles & REPLAY_MINOR_PLANETS);
     }
 
-    if (cameraType == "Venus") {
-      DisplayPlanetInfo("Venus", "Venus Menu", "4,8685x10^24 kg",
-                        "92,843x10^10 km³", "4,60x10^8 km²", "8,87 m/s2",
-                        "108.942.000 km", "243 dias", "225 dias",
-                        {{"Dióxido de Carbono", "96,5"},
-                         {"Nitrogênio", "3,5"},
-                         {"Dióxido de Enxofre", "0,015"},
-                         {"Argônio", "0,007"},
-                         {"Vapor de Água", "0,002"},
-                         {"Monóxido de Carbono", "0,0017"},
-                         {"Hélio", "0,0012"},
-                         {"Neônio", "0,0007"}});
-    }
+    if (cameraTarget >= 0)
+      DisplayPlanetInfo(catalog, cameraTarget);
 
-    if (cameraType == "Earth") {
-      DisplayPlanetInfo("Earth", "Earth Menu", "5,9736x10^24 kg",
-                        "1,08321x10^12 km³", "510.072.000 km²", "9,7 m/s2",
-                        "152.098.232 km", "23h 56min 4seg", "365,2563 dias",
-                        {{"Nitrogênio", "78,08"},
-                         {"Oxigênio", "20,95"},
-                         {"Argônio", "0,93"},
-                         {"Dióxido de Carbono", "0,038"},
-                         {"Vapor de Água", "~1 variável com o clima"}});
+    // advance the simulation in fixed steps, independent of the frame rate
+    simClock.rate = ticksPerSecond * speedModifier;
+    simClock.accumulate(deltaTime);
+    while (simClock.tick()) {
+      // planets are closed form in time, they are evaluated at render time
     }
-
-    if (cameraType == "Mars") {
-      DisplayPlanetInfo("Mars", "Mars Menu", "6,4174x10^23 kg",
-                        "1,6318x10^11 km³", "144.798.500 km²", "3,711 m/s2",
-                        "249.209.300 km", "1 dia e 37 minutos", "687 dias",
-                        {{"Dióxido de carbono", "95,97"},
-                         {"Argônio", "1,93"},
-                         {"Nitrogênio", "1,89"},
-                         {"Oxigênio", "0,146"},
-                         {"Monóido de Carbono", "0,0557"},
-                         {"Outros Elementos", "0,0083"}});
+    if (asteroidGravity) {
+      beltWarp.advance(belt, simClock.previous, simClock.time, gmSun,
+                       beltAttractors, workers);
+      broadphase.update(belt.x.data(), belt.y.data(), belt.z.data(),
+                        asteroidRadius.data(), belt.size(), workers);
     }
-
-    if (cameraType == "Jupiter") {
-      DisplayPlanetInfo("Jupiter", "Jupiter Menu", "1,8986x10^27 kg",
-                        "1,43128x10^15 km³", "6,21796x10^10 km²", "24,79 m/s2",
-                        "816.520.800 km", "9 horas e 56 minutos", "12 anos",
-                        {{"Hidrogénio", "89,8 ± 2,0"},
-                         {"Hélio", "10,2 ± 2,0"},
-                         {"Metano", "0,3"},
-                         {"Amônia", "0,146"},
-                         {"Fósforo", "0,0006"},
-                         {"Vapor de Água", "0,25"}});
+    double t = simClock.renderTime();
+
+    // whatever the loader parsed since the last frame
+    size_t minorLoaded = minorPlanets.size();
+    if (minorPlanetLoader.take(minorPlanets) > 0) {
+      minorPropagator.addElements(minorPlanets.elements, minorLoaded);
+      minorX.resize(minorPlanets.size());
+      minorY.resize(minorPlanets.size());
+      minorZ.resize(minorPlanets.size());
     }
 
-    if (cameraType == "Saturn") {
-      DisplayPlanetInfo("Saturn", "Saturn Menu", "5,6846x10^26 kg",
-                        "8,2713x10^14 km³", "4,27x10^10 km²", "10,44 m/s2",
-                        "1.513.325.783 km", "10 horas e 34 minutos",
-                        "29,4 anos",
-                        {{"Hidrogénio", "~96"},
-                         {"Hélio", "~3"},
-                         {"Metano", "~0,04"},
-                         {"Amoníaco", "~0,01"},
-                         {"Deuterídio de Hidrogénio", "~0,01"},
-                         {"Etano", "0,0007"}});
+    if (!replaying)
+      doMovement();
+
+    if (replaying) {
+      camera.Position = glm::vec3(replayFrame.position[0],
+                                  replayFrame.position[1],
+                                  replayFrame.position[2]);
+      camera.SetOrientation(replayFrame.yaw, replayFrame.pitch);
+      camera.Zoom = replayFrame.zoom;
+      if (t != replayFrame.time)
+        replayMismatches++;
+    } else if (recorder.isOpen()) {
+      ReplayFrame frame = {t,
+                           deltaTime,
+                           {camera.Position.x, camera.Position.y,
+                            camera.Position.z},
+                           camera.Yaw,
+                           camera.Pitch,
+                           camera.Zoom,
+                           speedModifier,
+                           cameraTarget,
+                           replayToggles()};
+      recorder.record(frame);
     }
 
-    if (cameraType == "Uranus") {
-      DisplayPlanetInfo("Uranus", "Uranus Menu", "(8,6810 ± 0,0013)x10^25 kg",
-                        "6,833x10^13 km³", "8,1156x10^9 km²", "8,69 m/s2",
-                        "3.004.419.704 km", "17 horas e 14 minutos", "84 anos",
-                        {{"Hidrogênio", "83 ± 3"},
-                         {"Hélio", "15 ± 3"},
-                         {"Metano", "2,3"},
-                         {"Amónio", "0,002"},
-                         {"Água", "0,01"},
-                         {"Hidrosulfureto de Amônio", "0.23"},
-                         {"Metano", "5.2%%"}});
-    }
+    glm::mat4 view = camera.GetViewMatrix();
 
-    if (cameraType == "Neptune") {
-      DisplayPlanetInfo("Neptune", "Neptune Menu", "1,0243x10^26 kg",
-                        "6,254x10^13 km³", "7,6183x10^9 km²", "11,15 m/s2",
-                        "4.553.946.490 km", "16 horas e 6 minutos", "165 anos",
-                        {{"Hidrogênio", "80 ± 3,2"},
-                         {"Hélio", "19 ± 3.2"},
-                         {"Metano", "1.5 ± 0.5"},
-                         {"Amoníaco", "0,002"},
-                         {"Água", "0,00065"},
-                         {"Hidrosulfureto de Amónio", "0,0009"},
-                         {"Hidrato de Metano", "0,0021"}});
+    glm::mat4 projection = glm::perspective(
+        glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, zNear, zFar);
+    glm::mat4 viewProjection = projection * view;
+    renderQueue.setFrustum(Frustum(&viewProjection[0][0]));
+
+    // this frame's belt, worked out in the background until the asteroids
+    // are drawn. Nothing it reads changes before then
+    size_t minorCount = showMinorPlanets ? minorPlanets.size() : 0;
+    bool orbiting = beltOnGpu && !asteroidGravity && minorCount == 0;
+    if (minorCount == 0 && !orbiting) {
+      float *instances = (float *)instanceStream.map(amount);
+      bool gravity = asteroidGravity;
+      double alpha = simClock.alpha();
+      // the view in the ecliptic frame, so the rocks are culled where they
+      // are, in AU
+      glm::mat4 ecliptic(glm::vec4(AU * scale, 0.0f, 0.0f, 0.0f),
+                         glm::vec4(0.0f, 0.0f, -AU * scale, 0.0f),
+                         glm::vec4(0.0f, AU * scale, 0.0f, 0.0f),
+                         glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+      glm::mat4 beltView = viewProjection * ecliptic;
+      Frustum beltFrustum(&beltView[0][0]);
+      beltJob.start([&, instances, gravity, alpha, t,
+                     beltFrustum](ThreadPool &pool) {
+        pool.parallelFor(
+            BELT_BLOCKS,
+            [&](size_t first, size_t past) {
+              for (size_t b = first; b < past; b++) {
+                size_t begin = amount * b / BELT_BLOCKS;
+                size_t end = amount * (b + 1) / BELT_BLOCKS;
+                if (gravity) {
+                  // where the belt is between its last two steps
+                  for (size_t i = begin; i < end; i++) {
+                    beltX[i] =
+                        belt.prevX[i] + (belt.x[i] - belt.prevX[i]) * alpha;
+                    beltY[i] =
+                        belt.prevY[i] + (belt.y[i] - belt.prevY[i]) * alpha;
+                    beltZ[i] =
+                        belt.prevZ[i] + (belt.z[i] - belt.prevZ[i]) * alpha;
+                  }
+                } else {
+                  beltPropagator.propagateRange(t, begin, end, beltX.data(),
+                                                beltY.data(), beltZ.data());
+                }
+                beltBlockStart[b + 1] = cullSpheres(
+                    beltFrustum, beltX.data(), beltY.data(), beltZ.data(),
+                    asteroidRadius.data(), begin, end, beltVisible.data());
+              }
+            },
+            1);
+
+        beltBlockStart[0] = 0;
+        for (size_t b = 0; b < BELT_BLOCKS; b++)
+          beltBlockStart[b + 1] += beltBlockStart[b];
+        pool.parallelFor(
+            BELT_BLOCKS,
+            [&](size_t first, size_t past) {
+              for (size_t b = first; b < past; b++)
+                compactInstances(&modelMatrices[0][0][0], beltX.data(),
+                                 beltY.data(), beltZ.data(), AU * scale,
+                                 beltVisible.data(), amount * b / BELT_BLOCKS,
+                                 amount * (b + 1) / BELT_BLOCKS,
+                                 instances + 16 * beltBlockStart[b]);
+            },
+            1);
+        beltInstances = beltBlockStart[BELT_BLOCKS];
+      });
     }
 
-    i += speedModifier;
-    if (i == UINT_MAX)
-      i = 0;
-    doMovement();
-
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -924,78 +1352,75 @@ int system() {
     glClearColor(0.00f, 0.00f, 0.00f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glm::mat4 view = camera.GetViewMatrix();
-
-    glm::mat4 projection = glm::perspective(
-        glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, zNear, zFar);
+    planetPositions(t);
+    std::vector<glm::vec3> planetPos(catalog.size());
+    for (size_t k = 0; k < catalog.size(); k++)
+      planetPos[k] = eclipticToWorld(planetX[k], planetY[k], planetZ[k]);
 
     glm::mat4 model(1);
 
-    shader.use();
-    shader.setVec3("viewPos", camera.Position);
-    shader.setMat4("projection", projection);
-    shader.setMat4("view", view);
+    CameraBlock cameraBlock;
+    cameraBlock.projection = projection;
+    cameraBlock.view = view;
+    cameraBlock.viewPos = glm::vec4(camera.Position, 1.0f);
+    uniformBlocks.setCamera(cameraBlock);
+    uniformBlocks.setLight(light);
+
+    // the belt moved and culled on the GPU, early in the frame so that the
+    // count of rocks in view is in by the time they are drawn
+    if (orbiting) {
+      if (orbitStale ||
+          fastestOrbit * fabs(t - orbitEpoch) > 2.0 * M_PI * ORBIT_EPOCH_LAPS)
+        packOrbits(t);
+      Frustum frustum(&viewProjection[0][0]);
+      cullShader.use();
+      for (int k = 0; k < 6; k++) {
+        const float *p = frustum.planes[k];
+        cullShader.set(cullPlanes[k], glm::vec4(p[0], p[1], p[2], p[3]));
+      }
+      cullShader.setFloat("cutoff", beltCutoff);
+      cullShader.setFloat("modelRadius", asteroidModel.radius);
+      cullShader.setFloat("time", (float)(t - orbitEpoch));
+      cullShader.setFloat("unit", AU * scale);
+      cullShader.setVec3("spinAxis",
+                         glm::normalize(glm::vec3(0.4f, 0.6f, 0.8f)));
+      cullShader.setFloat("maxTurns", ORBIT_INSTANCE_MAX_TURNS);
+      beltCuller.run(amount);
+    }
 
-    pathShader.use();
-    pathShader.setMat4("projection", projection);
-    pathShader.setMat4("view", view);
+    for (size_t k = 0; k < catalog.size(); k++) {
+      scene.setPosition(orbitNode[k],
+                        move ? planetPos[k]
+                             : glm::vec3(catalog.a[k] * scale, 0.0f, 0.0f));
+      // Inner rotation
+      float angle = fmod(catalog.spin[k] * speed * t * 1.35, 2 * PI);
+      scene.setRotation(bodyNode[k], catalog.yaw[k] + angle);
+    }
+    double days = t * planetElements.n[earth] / (2.0 * PI) * 365.25;
+    for (size_t m = 0; m < catalog.moonCount(); m++) {
+      float angle = fmod(days / catalog.moonPeriod[m], 1.0) * 2 * PI;
+      scene.setRotation(moonPivot[m], catalog.moonPhase[m] + angle);
+    }
+    scene.update();
 
-    asteroidShader.use();
-    asteroidShader.setMat4("projection", projection);
-    asteroidShader.setMat4("view", view);
-
-    // MERCURY
-    draw_planet(move, i, view, projection, 0.39f, 1.0f, 49.9f * outerSpeed,
-                10.83f * speed, 0.0f, "Mercury", shader, pathShader,
-                mercuryModel, &mercurySphere);
-
-    // VENUS
-    draw_planet(move, i, view, projection, 0.72f, 1.0f, 35.0f * outerSpeed,
-                6.52f * speed, 0.0f, "Venus", shader, pathShader, venusModel,
-                &venusSphere);
-    // EARTH
     earthShader.use();
-    earthShader.setVec3("viewPos", camera.Position);
-    earthShader.setMat4("projection", projection);
-    earthShader.setMat4("view", view);
-    draw_planet(move, i, view, projection, 1.0f, 1.4f, 29.8f * outerSpeed,
-                1574.0f * speed, 0.0f, "Earth", earthShader, pathShader,
-                earthModel, &earthSphere, &moonModel, &shader,
-                earthNightTextureID, earthCloudTextureID);
-
-    // MARS
-    draw_planet(move, i, view, projection, 1.52f, 1.0f, 24.1f * outerSpeed,
-                866.0f * speed, 0.0f, "Mars", shader, pathShader, marsModel,
-                &marsSphere);
-
-    // JUPITER
-    draw_planet(move, i, view, projection, 5.20f, 1.0f, 13.1f * outerSpeed,
-                45583.0f * speed, 0.0f, "Jupiter", shader, pathShader,
-                jupiterModel, &jupiterSphere);
-
-    // SATURN
-    draw_planet(move, i, view, projection, 9.54f, 1.0f, 9.7f * outerSpeed,
-                36840.0f * speed, 90.0f, "Saturn", shader, pathShader,
-                saturnModel, &saturnSphere);
-
-    // Uranus
-    draw_planet(move, i, view, projection, 14.22f, 1.0f, 6.8f * outerSpeed,
-                14797.0f * speed, 160.0f, "Uranus", shader, pathShader,
-                uranusModel, &uranusSphere);
-
-    // NEPTUNE
-    draw_planet(move, i, view, projection, 23.06f, 1.0f, 5.4f * outerSpeed,
-                9719.0f * speed, 130.0f, "Neptune", shader, pathShader,
-                neptuneModel, &neptuneSphere);
+    earthShader.setFloat("time", glfwGetTime());
 
-    // SUN
-    lampShader.use();
-    lampShader.setMat4("view", view);
-    lampShader.setMat4("projection", projection);
+    renderQueue.setDepthRange(zNear, zFar);
 
-    model = glm::mat4(1);
-    model = glm::translate(model, lightPos);
-    model = glm::scale(model, glm::vec3(scale));
+    // PLANETS
+    for (size_t k = 0; k < catalog.size(); k++)
+      draw_planet(move, view, projection, catalog, k, scene, orbitNode[k],
+                  bodyNode[k], renderQueue, assets[planetModels[k]],
+                  planetMaterials[k], planetLevels[k], &planetSpheres[k]);
+
+    // MOONS
+    for (size_t m = 0; m < catalog.moonCount(); m++)
+      submit_model(renderQueue, assets[moonModels[m]], moonMaterials[m],
+                   moonLevels[m], scene.world(moonNode[m]));
+
+    // SUN
+    model = scene.world(sunNode);
 
     glm::mat4 sunVp = projection * view;
     glm::vec4 sunClipCoords = sunVp * glm::vec4(lightPos, 1.0);
@@ -1019,10 +1444,83 @@ int system() {
       ImGui::End();
     }
 
-    shader.setMat4("model", model);
-    lampShader.setMat4("model", model);
+    submit_model(renderQueue, sunModel, sunMaterials, sunLevels, model);
+
+    // every body above, fewest state changes first
+    renderQueue.execute();
+
+    // every orbit in one draw, as finely cut as the view needs
+    orbitVertices = 0;
+    if (move && showPlanetTrajectories) {
+      // pixels per radian at the middle of the screen
+      float pixels =
+          SCREEN_HEIGHT / (2.0f * tan(glm::radians(camera.Zoom) * 0.5f));
+      orbitPaths.update(planetElements, planetPropagator, AU * scale,
+                        camera.Position, pixels);
+      orbitVertices = orbitPaths.vertices();
+      pathShader.use();
+      pathShader.setVec3("pathColor", glm::vec3(0.15f, 0.15f, 0.15f));
+      pathShader.setMat4("model", glm::mat4(1.0f));
+      orbitPaths.draw();
+    }
 
-    sunModel.Draw(lampShader);
+    unsigned int asteroidInstances = amount;
+    if (minorCount > 0) {
+      workers.parallelFor(minorCount, [&](size_t begin, size_t end) {
+        minorPropagator.propagateRange(t, begin, end, minorX.data(),
+                                       minorY.data(), minorZ.data());
+      });
+
+      glm::vec3 eye = camera.Position;
+      float reach2 = MINOR_PLANET_NEAR * MINOR_PLANET_NEAR;
+      workers.parallelFor(
+          MINOR_PLANET_BLOCKS,
+          [&](size_t first, size_t past) {
+            for (size_t b = first; b < past; b++) {
+              std::vector<uint32_t> &nearby = nearbyMinorPlanets[b];
+              nearby.clear();
+              size_t end = minorCount * (b + 1) / MINOR_PLANET_BLOCKS;
+              for (size_t i = minorCount * b / MINOR_PLANET_BLOCKS; i < end;
+                   i++) {
+                glm::vec3 d =
+                    eclipticToWorld(minorX[i], minorY[i], minorZ[i]) - eye;
+                if (glm::dot(d, d) < reach2)
+                  nearby.push_back((uint32_t)i);
+              }
+            }
+          },
+          1);
+
+      rockCount = 0;
+      for (size_t b = 0; b < MINOR_PLANET_BLOCKS; b++) {
+        const std::vector<uint32_t> &nearby = nearbyMinorPlanets[b];
+        for (size_t k = 0;
+             k < nearby.size() && rockCount < MINOR_PLANET_ROCKS; k++) {
+          uint32_t i = nearby[k];
+          float size =
+              std::min(0.05f + minorPlanets.diameter[i] * 0.00045f, 0.5f);
+          glm::vec3 position = eclipticToWorld(minorX[i], minorY[i], minorZ[i]);
+          glm::mat4 rock = glm::translate(glm::mat4(1.0f), position);
+          rock = glm::scale(rock, glm::vec3(size));
+          rock = glm::rotate(rock, (float)(i % 628) * 0.01f,
+                             glm::vec3(0.4f, 0.6f, 0.8f));
+          rockMatrices[rockCount++] = rock;
+        }
+      }
+      void *rocks = instanceStream.map(rockCount);
+      if (rocks != NULL)
+        memcpy(rocks, rockMatrices.data(), rockCount * sizeof(glm::mat4));
+      asteroidInstances = rockCount;
+    } else if (orbiting) {
+      asteroidInstances = (unsigned int)beltCuller.visible();
+    } else {
+      beltJob.wait();
+      asteroidInstances = (unsigned int)beltInstances;
+    }
+    if (orbiting)
+      pointInstances(beltCuller.buffer(), 0);
+    else
+      pointInstances(instanceStream.buffer(), instanceStream.unmap());
 
     model = glm::mat4(1);
     asteroidShader.use();
@@ -1038,20 +1536,48 @@ int system() {
       glDrawElementsInstanced(
           GL_TRIANGLES,
           static_cast<unsigned int>(asteroidModel.meshes[i].indices.size()),
-          GL_UNSIGNED_INT, 0, amount);
+          GL_UNSIGNED_INT, 0, asteroidInstances);
+      glBindVertexArray(0);
+    }
+    if (!orbiting)
+      instanceStream.fence();
+
+    // every minor planet as a point, the rocks above cover the near ones
+    if (minorCount > 0) {
+      glBindVertexArray(pointVAO);
+      glBindBuffer(GL_ARRAY_BUFFER, pointVBO);
+      if (minorCount > pointCapacity) {
+        pointCapacity = std::max(minorCount, pointCapacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, 3 * pointCapacity * sizeof(float), NULL,
+                     GL_STREAM_DRAW);
+        for (unsigned int c = 0; c < 3; c++) {
+          glEnableVertexAttribArray(c);
+          glVertexAttribPointer(c, 1, GL_FLOAT, GL_FALSE, sizeof(float),
+                                (void *)(c * pointCapacity * sizeof(float)));
+        }
+      }
+      size_t plane = pointCapacity * sizeof(float);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, minorCount * sizeof(float),
+                      minorX.data());
+      glBufferSubData(GL_ARRAY_BUFFER, plane, minorCount * sizeof(float),
+                      minorY.data());
+      glBufferSubData(GL_ARRAY_BUFFER, 2 * plane, minorCount * sizeof(float),
+                      minorZ.data());
+
+      pointShader.use();
+      pointShader.setFloat("auScale", AU * scale);
+      pointShader.setVec3("pointColor", glm::vec3(0.55f, 0.5f, 0.45f));
+      glDrawArrays(GL_POINTS, 0, (GLsizei)minorCount);
       glBindVertexArray(0);
     }
 
-    if (cameraType == "Up") {
+    if (cameraTarget == CAMERA_UP) {
       camera.Position = (glm::vec3(0, 1500, 0));
     }
 
     /* DRAW SKYBOX */
     glDepthFunc(GL_LEQUAL);
     skyboxShader.use();
-    view = glm::mat4(glm::mat3(camera.GetViewMatrix()));
-    skyboxShader.setMat4("view", view);
-    skyboxShader.setMat4("projection", projection);
     // skybox cube
     glBindVertexArray(skyboxVAO);
     glActiveTexture(GL_TEXTURE0);
@@ -1066,7 +1592,7 @@ int system() {
       blurShader.use();
       for (unsigned int i = 0; i < blurPasses; i++) {
         glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-        blurShader.setInt("horizontal", horizontal);
+        blurShader.set(blurHorizontal, (int)horizontal);
         glBindTexture(
             GL_TEXTURE_2D,
             first_iteration
@@ -1090,9 +1616,6 @@ int system() {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     screenShader.use();
-    // Assuming clipSpacePosition is a glm::vec4
-    screenShader.setMat4("view", view);
-    screenShader.setMat4("projection", projection);
     screenShader.setVec3("screenLightPos", glm::vec3(sunScreenPos));
     screenShader.setBool("bloomActive", bloomActive);
 
@@ -1101,16 +1624,11 @@ int system() {
     float rayLength = glm::length(sunSphere.center - camera.Position);
     glm::vec3 rayEndPoint = camera.Position + rayDirection * rayLength;
     if (lensFlareActive) {
-      bool sunVisible =
-          !isIntersecting(camera.Position, rayDirection, mercurySphere,
-                          10.0f) &&
-          !isIntersecting(camera.Position, rayDirection, venusSphere, 2.0f) &&
-          !isIntersecting(camera.Position, rayDirection, earthSphere, 2.0f) &&
-          !isIntersecting(camera.Position, rayDirection, marsSphere) &&
-          !isIntersecting(camera.Position, rayDirection, jupiterSphere, 1.5f) &&
-          !isIntersecting(camera.Position, rayDirection, saturnSphere) &&
-          !isIntersecting(camera.Position, rayDirection, uranusSphere) &&
-          !isIntersecting(camera.Position, rayDirection, neptuneSphere);
+      bool sunVisible = true;
+      for (size_t k = 0; k < catalog.size() && sunVisible; k++)
+        sunVisible = !isIntersecting(camera.Position, rayDirection,
+                                     planetSpheres[k],
+                                     catalog.flareCorrection[k]);
       screenShader.setBool("sunVisibleAndEnabled", sunVisible);
     } else {
       screenShader.setBool("sunVisibleAndEnabled", false);
@@ -1136,12 +1654,15 @@ int system() {
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
 
+  beltCuller.release();
+  uniformBlocks.release();
+  assets.release();
   glfwTerminate();
   return 0;
 }
 
 void doMovement() {
-  if (cameraType == "") {
+  if (cameraTarget == CAMERA_FREE) {
     if (keys[GLFW_KEY_W] || keys[GLFW_KEY_UP]) {
       camera.ProcessKeyboard(FORWARD, deltaTime);
     }
@@ -1181,35 +1702,18 @@ void doMovement() {
     lastKeyPressTime = currentTime;
   }
 
-  if (keys[GLFW_KEY_1]) {
-    cameraType = "Mercury";
-    return;
-  } else if (keys[GLFW_KEY_2]) {
-    cameraType = "Venus";
-    return;
-  } else if (keys[GLFW_KEY_3]) {
-    cameraType = "Earth";
-    return;
-  } else if (keys[GLFW_KEY_4]) {
-    cameraType = "Mars";
-    return;
-  } else if (keys[GLFW_KEY_5]) {
-    cameraType = "Jupiter";
-    return;
-  } else if (keys[GLFW_KEY_6]) {
-    cameraType = "Saturn";
-    return;
-  } else if (keys[GLFW_KEY_7]) {
-    cameraType = "Uranus";
-    return;
-  } else if (keys[GLFW_KEY_8]) {
-    cameraType = "Neptune";
-    return;
-  } else if (keys[GLFW_KEY_0]) {
-    cameraType = "";
+  // 1 to 9 follow the planets in catalog order
+  for (int k = 0; k < 9 && k < planetCount; k++) {
+    if (keys[GLFW_KEY_1 + k]) {
+      cameraTarget = k;
+      return;
+    }
+  }
+  if (keys[GLFW_KEY_0]) {
+    cameraTarget = CAMERA_FREE;
     return;
   } else if (keys[GLFW_KEY_U]) {
-    cameraType = "Up";
+    cameraTarget = CAMERA_UP;
     return;
   }
 
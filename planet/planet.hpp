@@ -3,6 +3,11 @@
 
 #include <stdio.h>
 
-int system();
+// runs the scene. With recordPath every frame is recorded to that file, with
+// replayPath the frames of a recording are played back instead of the user's,
+// with resumePath the simulation starts from a snapshot saved there; any can
+// be NULL
+int system(const char *recordPath, const char *replayPath,
+           const char *resumePath);
 
 #endif /* planet_hpp */
@@ -0,0 +1,49 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// Counter based random numbers: Philox4x32-10 (Salmon et al., "Parallel
+// random numbers: as easy as 1, 2, 3", SC 2011). A block of four words is a
+// pure function of the seed and a counter, so block n can be drawn on any
+// thread, in any order, without going through blocks 0 to n-1 first. Handing
+// every object its own counter gives each one numbers of its own that do not
+// depend on how the work was split.
+class Philox {
+public:
+  explicit Philox(uint64_t seed)
+      : key0((uint32_t)seed), key1((uint32_t)(seed >> 32)) {}
+
+  // the four words of block index of a stream
+  void block(uint64_t index, uint32_t stream, uint32_t out[4]) const {
+    uint32_t c0 = (uint32_t)index, c1 = (uint32_t)(index >> 32), c2 = stream,
+             c3 = 0;
+    uint32_t k0 = key0, k1 = key1;
+    for (int round = 0; round < 10; round++) {
+      uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+      uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+      uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+      uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+      c1 = (uint32_t)p1;
+      c3 = (uint32_t)p0;
+      c0 = n0;
+      c2 = n2;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+
+  // a word to a float in [0, 1), from its top 24 bits
+  static float uniform(uint32_t bits) {
+    return (float)(bits >> 8) * (1.0f / 16777216.0f);
+  }
+
+private:
+  uint32_t key0, key1;
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <cmath>
+
+size_t RenderQueue::material(Shader &shader, const Textures &textures) {
+  Material m;
+  m.shader = &shader;
+  m.model = shader.uniform<glm::mat4>("model");
+  m.textureCount = std::min(textures.size(), (size_t)MAX_TEXTURES);
+  for (size_t i = 0; i < m.textureCount; i++) {
+    m.textures[i] = textures[i].second;
+    m.samplers[i] = shader.uniform<int>(textures[i].first);
+  }
+
+  for (size_t k = 0; k < materials.size(); k++) {
+    const Material &o = materials[k];
+    bool same = o.shader->ID == shader.ID &&
+                o.textureCount == m.textureCount &&
+                std::equal(m.textures, m.textures + m.textureCount, o.textures);
+    for (size_t i = 0; same && i < m.textureCount; i++)
+      same = o.samplers[i].slot == m.samplers[i].slot;
+    if (same)
+      return k;
+  }
+  materials.push_back(m);
+  return materials.size() - 1;
+}
+
+size_t RenderQueue::meshMaterial(Shader &shader, const Mesh &mesh,
+                                 const Textures &extra) {
+  Textures textures;
+  unsigned int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
+  for (size_t i = 0; i < mesh.textures.size(); i++) {
+    const std::string &name = mesh.textures[i].type;
+    std::string number;
+    if (name == "texture_diffuse")
+      number = std::to_string(diffuseNr++);
+    else if (name == "texture_specular")
+      number = std::to_string(specularNr++);
+    else if (name == "texture_normal")
+      number = std::to_string(normalNr++);
+    else if (name == "texture_height")
+      number = std::to_string(heightNr++);
+    textures.push_back(std::make_pair(name + number, mesh.textures[i].id));
+  }
+  textures.insert(textures.end(), extra.begin(), extra.end());
+  return material(shader, textures);
+}
+
+void RenderQueue::submit(Pass pass, size_t material, GLuint vao,
+                         GLsizei count, const glm::mat4 &model, float depth,
+                         const glm::vec3 &center, float radius) {
+  push(pass, material, vao, 0, count, count, model, depth, center, radius);
+}
+
+void RenderQueue::submit(Pass pass, size_t material, const Mesh &mesh,
+                         size_t lod, const glm::mat4 &model, float depth,
+                         const glm::vec3 &center, float radius) {
+  const Mesh::Lod &level = mesh.lods[std::min(lod, mesh.lods.size() - 1)];
+  push(pass, material, mesh.VAO, (GLsizei)level.first, (GLsizei)level.count,
+       (GLsizei)mesh.indices.size(), model, depth, center, radius);
+}
+
+void RenderQueue::push(Pass pass, size_t material, GLuint vao, GLsizei first,
+                       GLsizei count, GLsizei detail, const glm::mat4 &model,
+                       float depth, const glm::vec3 &center, float radius) {
+  const Material &m = materials[material];
+  // depth in [0, 1) over the range, blended draws go far to near
+  float d = (depth - depthNear) / (depthFar - depthNear);
+  d = std::min(std::max(d, 0.0f), 1.0f);
+  uint64_t z = (uint64_t)(d * 65535.0f);
+  if (pass == BLEND_PASS)
+    z = 65535 - z;
+  GLuint texture = m.textureCount > 0 ? m.textures[0] : 0;
+
+  Item item;
+  item.key = ((uint64_t)pass << 60) |
+             ((uint64_t)(m.shader->ID & 0xFFF) << 48) |
+             ((uint64_t)(texture & 0xFFFF) << 32) |
+             ((uint64_t)(vao & 0xFFFF) << 16) | z;
+  item.material = (uint32_t)material;
+  item.vao = vao;
+  item.first = first;
+  item.count = count;
+  item.detail = detail;
+  item.model = model;
+  items.push_back(item);
+  boundX.push_back(center.x);
+  boundY.push_back(center.y);
+  boundZ.push_back(center.z);
+  boundRadius.push_back(radius);
+}
+
+void RenderQueue::execute() {
+  visible.resize(items.size());
+  cullSpheres(frustum, boundX.data(), boundY.data(), boundZ.data(),
+              boundRadius.data(), 0, items.size(), visible.data());
+  order.clear();
+  for (size_t i = 0; i < items.size(); i++)
+    if (visible[i])
+      order.push_back((uint32_t)i);
+  // ties keep the order they were submitted in
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return items[a].key < items[b].key;
+  });
+
+  Counters now = Counters(), before = Counters();
+  GLuint program = 0, vao = 0;
+  size_t material = materials.size();
+  GLuint bound[MAX_TEXTURES] = {0};
+  for (size_t k = 0; k < order.size(); k++) {
+    const Item &item = items[order[k]];
+    const Material &m = materials[item.material];
+    before.programs++;
+    before.textures += m.textureCount;
+    before.vertexArrays++;
+    before.triangles += item.detail / 3;
+
+    if (m.shader->ID != program) {
+      m.shader->use();
+      program = m.shader->ID;
+      now.programs++;
+    }
+    if (item.material != material) {
+      for (size_t i = 0; i < m.textureCount; i++) {
+        if (bound[i] != m.textures[i]) {
+          glActiveTexture(GL_TEXTURE0 + i);
+          glBindTexture(GL_TEXTURE_2D, m.textures[i]);
+          bound[i] = m.textures[i];
+          now.textures++;
+        }
+        m.shader->set(m.samplers[i], (int)i);
+      }
+      material = item.material;
+    }
+    if (item.vao != vao) {
+      glBindVertexArray(item.vao);
+      vao = item.vao;
+      now.vertexArrays++;
+    }
+
+    m.shader->set(m.model, item.model);
+    glDrawElements(GL_TRIANGLES, item.count, GL_UNSIGNED_INT,
+                   (void *)(item.first * sizeof(GLuint)));
+    now.draws++;
+    now.triangles += item.count / 3;
+  }
+  now.culled = items.size() - order.size();
+  before.draws = now.draws;
+  before.culled = now.culled;
+
+  // leave things as the rest of the frame expects them
+  glBindVertexArray(0);
+  glActiveTexture(GL_TEXTURE0);
+
+  counters = now;
+  unsorted = before;
+  items.clear();
+  boundX.clear();
+  boundY.clear();
+  boundZ.clear();
+  boundRadius.clear();
+}
@@ -0,0 +1,123 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frustum.h"
+#include "mesh.h"
+#include "shader.h"
+
+// Draws submitted over a frame and issued together, sorted so that GL state
+// changes as little as possible between them.
+//
+// Every draw gets a 64 bit key, from the top: the pass (4 bits), the program
+// (12), the first texture of its material (16), its vertex array (16) and
+// its depth (16). Sorting the keys groups draws that share a program, then a
+// texture, then a mesh, and within a group puts opaque draws front to back
+// and blended ones back to front. execute() then only binds what differs
+// from the draw before. Ids wider than their field only cost some grouping.
+//
+// Per frame uniforms (view, projection, lights) are set by the caller on the
+// programs as before, execute() sets the model matrix of every draw through
+// a handle resolved with the material.
+//
+// Every draw comes with a bounding sphere. execute() tests them all against
+// the frustum in one go and leaves out the draws wholly outside it.
+class RenderQueue {
+public:
+  enum Pass { OPAQUE_PASS = 0, BLEND_PASS = 1 };
+  static const int MAX_TEXTURES = 8;
+  // sampler uniforms and the textures bound for them
+  typedef std::vector<std::pair<std::string, GLuint>> Textures;
+
+  // GL calls a frame cost
+  struct Counters {
+    size_t draws;
+    size_t programs;     // glUseProgram()
+    size_t textures;     // glBindTexture()
+    size_t vertexArrays; // glBindVertexArray()
+    size_t culled;       // draws left out, outside the frustum
+    size_t triangles;    // drawn
+  };
+  // of the last execute(), and what the same draws cost before, every draw
+  // binding its program, all its textures and its vertex array, and drawing
+  // its mesh at full detail
+  Counters counters, unsorted;
+
+  RenderQueue() : counters(), unsorted(), depthNear(0.1f), depthFar(1.0f) {}
+
+  // A program and the textures it samples, bound to units 0, 1, ... in
+  // order, each set on its sampler uniform. The same program and textures
+  // give the same material back. Call once, not every frame
+  size_t material(Shader &shader, const Textures &textures);
+  // the material of a mesh drawn by Mesh::Draw(), its textures named the way
+  // Mesh::Draw() names them, followed by extra
+  size_t meshMaterial(Shader &shader, const Mesh &mesh,
+                      const Textures &extra = Textures());
+
+  // depths of the frame are placed between these, view space distances
+  void setDepthRange(float near, float far) {
+    depthNear = near;
+    depthFar = far;
+  }
+
+  // draws are culled against this one, world space. Holds everything until
+  // set
+  void setFrustum(const Frustum &frustum) { this->frustum = frustum; }
+
+  // queues count indices of vao with a material, depth away from the camera,
+  // inside the sphere of radius around center in world space
+  void submit(Pass pass, size_t material, GLuint vao, GLsizei count,
+              const glm::mat4 &model, float depth, const glm::vec3 &center,
+              float radius);
+  // queues level lod of a mesh
+  void submit(Pass pass, size_t material, const Mesh &mesh, size_t lod,
+              const glm::mat4 &model, float depth, const glm::vec3 &center,
+              float radius);
+
+  // sorts and draws everything submitted, then empties the queue
+  void execute();
+
+  size_t size() const { return items.size(); }
+
+private:
+  struct Material {
+    Shader *shader;
+    Uniform<glm::mat4> model;
+    size_t textureCount;
+    GLuint textures[MAX_TEXTURES];
+    Uniform<int> samplers[MAX_TEXTURES];
+  };
+  struct Item {
+    uint64_t key;
+    uint32_t material;
+    GLuint vao;
+    GLsizei first, count;
+    GLsizei detail; // indices of the mesh at full detail
+    glm::mat4 model;
+  };
+
+  std::vector<Material> materials;
+  std::vector<Item> items;
+  // bounding spheres of the items, one array per coordinate for cullSpheres()
+  std::vector<float> boundX, boundY, boundZ, boundRadius;
+  std::vector<uint8_t> visible;
+  Frustum frustum;
+  // indices of items, sorted by key
+  std::vector<uint32_t> order;
+  float depthNear, depthFar;
+
+  void push(Pass pass, size_t material, GLuint vao, GLsizei first,
+            GLsizei count, GLsizei detail, const glm::mat4 &model, float depth,
+            const glm::vec3 &center, float radius);
+};
+
+#endif
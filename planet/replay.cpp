@@ -0,0 +1,246 @@
+#include "replay.h"
+
+#include <cstring>
+#include <iostream>
+
+// version 2 fields come from the counter based generator
+static const uint32_t REPLAY_VERSION = 2;
+static const size_t HEADER_BYTES = 32;
+// encoded records are written out once this many bytes are waiting
+static const size_t FLUSH_BYTES = 64 * 1024;
+
+// fields of a frame, as they are numbered in the change mask
+static const unsigned TIME_FIELD = 0;
+static const unsigned FIRST_FLOAT_FIELD = 1;
+static const unsigned FLOAT_FIELDS = 7;
+static const unsigned SPEED_FIELD = 8;
+static const unsigned TARGET_FIELD = 9;
+static const unsigned TOGGLES_FIELD = 10;
+
+static void putVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back((uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back((uint8_t)value);
+}
+
+static bool getVarint(const std::vector<uint8_t> &in, size_t &offset,
+                      uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (offset >= in.size())
+      return false;
+    uint8_t byte = in[offset++];
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// small differences of either sign become small unsigned numbers
+static uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static int32_t difference(int32_t a, int32_t b) {
+  return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+static uint64_t timeBits(const ReplayFrame &frame) {
+  uint64_t bits;
+  memcpy(&bits, &frame.time, sizeof(bits));
+  return bits;
+}
+
+static void getFloatBits(const ReplayFrame &frame,
+                         uint32_t bits[FLOAT_FIELDS]) {
+  float values[FLOAT_FIELDS] = {frame.delta,       frame.position[0],
+                                frame.position[1], frame.position[2],
+                                frame.yaw,         frame.pitch,
+                                frame.zoom};
+  memcpy(bits, values, sizeof(values));
+}
+
+static void setFloatBits(ReplayFrame &frame,
+                         const uint32_t bits[FLOAT_FIELDS]) {
+  float values[FLOAT_FIELDS];
+  memcpy(values, bits, sizeof(values));
+  frame.delta = values[0];
+  frame.position[0] = values[1];
+  frame.position[1] = values[2];
+  frame.position[2] = values[3];
+  frame.yaw = values[4];
+  frame.pitch = values[5];
+  frame.zoom = values[6];
+}
+
+bool ReplayRecorder::open(const std::string &path,
+                          const ReplayHeader &header) {
+  close();
+  file = fopen(path.c_str(), "wb");
+  if (file == NULL) {
+    std::cout << "ERROR::REPLAY::Could not create " << path << std::endl;
+    return false;
+  }
+
+  uint32_t fields[3] = {REPLAY_VERSION, header.seed, header.asteroids};
+  fwrite("SREP", 1, 4, file);
+  fwrite(fields, sizeof(uint32_t), 3, file);
+  fwrite(&header.step, sizeof(double), 1, file);
+  fwrite(&header.ticksPerSecond, sizeof(double), 1, file);
+
+  memset(&previous, 0, sizeof(previous));
+  buffer.clear();
+  buffer.reserve(FLUSH_BYTES * 2);
+  frames = 0;
+  bytes = HEADER_BYTES;
+  return true;
+}
+
+void ReplayRecorder::close() {
+  if (file == NULL)
+    return;
+  flush();
+  fclose(file);
+  file = NULL;
+}
+
+void ReplayRecorder::flush() {
+  if (buffer.empty())
+    return;
+  fwrite(&buffer[0], 1, buffer.size(), file);
+  bytes += buffer.size();
+  buffer.clear();
+}
+
+void ReplayRecorder::record(const ReplayFrame &frame) {
+  if (file == NULL)
+    return;
+
+  uint64_t time = timeBits(frame), lastTime = timeBits(previous);
+  uint32_t floats[FLOAT_FIELDS], lastFloats[FLOAT_FIELDS];
+  getFloatBits(frame, floats);
+  getFloatBits(previous, lastFloats);
+
+  uint32_t mask = 0;
+  if (time != lastTime)
+    mask |= 1 << TIME_FIELD;
+  for (unsigned f = 0; f < FLOAT_FIELDS; f++)
+    if (floats[f] != lastFloats[f])
+      mask |= 1 << (FIRST_FLOAT_FIELD + f);
+  if (frame.speedModifier != previous.speedModifier)
+    mask |= 1 << SPEED_FIELD;
+  if (frame.cameraTarget != previous.cameraTarget)
+    mask |= 1 << TARGET_FIELD;
+  if (frame.toggles != previous.toggles)
+    mask |= 1 << TOGGLES_FIELD;
+
+  putVarint(buffer, mask);
+  if (mask & 1 << TIME_FIELD)
+    putVarint(buffer, time ^ lastTime);
+  for (unsigned f = 0; f < FLOAT_FIELDS; f++)
+    if (mask & 1 << (FIRST_FLOAT_FIELD + f))
+      putVarint(buffer, floats[f] ^ lastFloats[f]);
+  if (mask & 1 << SPEED_FIELD)
+    putVarint(buffer, zigzag(difference(frame.speedModifier,
+                                        previous.speedModifier)));
+  if (mask & 1 << TARGET_FIELD)
+    putVarint(buffer,
+              zigzag(difference(frame.cameraTarget, previous.cameraTarget)));
+  if (mask & 1 << TOGGLES_FIELD)
+    putVarint(buffer, frame.toggles);
+
+  previous = frame;
+  frames++;
+  if (buffer.size() >= FLUSH_BYTES)
+    flush();
+}
+
+bool ReplayPlayer::open(const std::string &path) {
+  data.clear();
+  offset = 0;
+  frames = 0;
+  memset(&previous, 0, sizeof(previous));
+
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    std::cout << "ERROR::REPLAY::Could not read " << path << std::endl;
+    return false;
+  }
+  uint8_t block[4096];
+  size_t got;
+  while ((got = fread(block, 1, sizeof(block), file)) > 0)
+    data.insert(data.end(), block, block + got);
+  fclose(file);
+
+  uint32_t version = 0;
+  if (data.size() >= HEADER_BYTES)
+    memcpy(&version, &data[4], sizeof(version));
+  if (data.size() < HEADER_BYTES || memcmp(&data[0], "SREP", 4) != 0 ||
+      version != REPLAY_VERSION) {
+    std::cout << "ERROR::REPLAY::" << path << " is not a version "
+              << REPLAY_VERSION << " replay" << std::endl;
+    data.clear();
+    return false;
+  }
+  memcpy(&header.seed, &data[8], sizeof(uint32_t));
+  memcpy(&header.asteroids, &data[12], sizeof(uint32_t));
+  memcpy(&header.step, &data[16], sizeof(double));
+  memcpy(&header.ticksPerSecond, &data[24], sizeof(double));
+  offset = HEADER_BYTES;
+  return true;
+}
+
+bool ReplayPlayer::next(ReplayFrame &frame) {
+  uint64_t mask;
+  if (!getVarint(data, offset, mask))
+    return false;
+
+  frame = previous;
+  uint64_t value;
+  if (mask & 1 << TIME_FIELD) {
+    if (!getVarint(data, offset, value))
+      return false;
+    uint64_t time = timeBits(previous) ^ value;
+    memcpy(&frame.time, &time, sizeof(time));
+  }
+
+  uint32_t floats[FLOAT_FIELDS];
+  getFloatBits(previous, floats);
+  for (unsigned f = 0; f < FLOAT_FIELDS; f++) {
+    if (!(mask & 1 << (FIRST_FLOAT_FIELD + f)))
+      continue;
+    if (!getVarint(data, offset, value))
+      return false;
+    floats[f] ^= (uint32_t)value;
+  }
+  setFloatBits(frame, floats);
+
+  if (mask & 1 << SPEED_FIELD) {
+    if (!getVarint(data, offset, value))
+      return false;
+    frame.speedModifier = (int32_t)((uint32_t)previous.speedModifier +
+                                    (uint32_t)unzigzag((uint32_t)value));
+  }
+  if (mask & 1 << TARGET_FIELD) {
+    if (!getVarint(data, offset, value))
+      return false;
+    frame.cameraTarget = (int32_t)((uint32_t)previous.cameraTarget +
+                                   (uint32_t)unzigzag((uint32_t)value));
+  }
+  if (mask & 1 << TOGGLES_FIELD) {
+    if (!getVarint(data, offset, value))
+      return false;
+    frame.toggles = (uint32_t)value;
+  }
+
+  previous = frame;
+  frames++;
+  return true;
+}
@@ -0,0 +1,118 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Record and replay of everything that drives the simulation, a frame at a
+// time: the real time the frame took, what the user set and where the camera
+// looked. Played back from the same asteroid seed, the frames reproduce the
+// simulation clock step for step, with or without a window.
+//
+// The log is little endian: a header
+//
+//   char magic[4] = "SREP"; uint32 version = 2; uint32 seed;
+//   uint32 asteroids; double step; double ticksPerSecond;
+//
+// then one record per frame: a varint mask of the fields that changed since
+// the previous frame, bit k for the k-th field of ReplayFrame (the camera
+// position counts as three), followed by those fields in order. Floats
+// and doubles are stored as the varint of their bits xor the previous bits,
+// which is short when only the low mantissa bits moved; integers as the
+// zigzag varint of their difference. A frame where the camera sits still
+// takes about ten bytes.
+
+// toggles of the menu a replay restores
+enum ReplayToggle {
+  REPLAY_TRAJECTORIES = 1 << 0,
+  REPLAY_LABELS = 1 << 1,
+  REPLAY_LENS_FLARE = 1 << 2,
+  REPLAY_BLOOM = 1 << 3,
+  REPLAY_ASTEROID_GRAVITY = 1 << 4,
+  REPLAY_MINOR_PLANETS = 1 << 5,
+};
+
+struct ReplayHeader {
+  // asteroid field seed and size
+  uint32_t seed;
+  uint32_t asteroids;
+  // simulation clock step and ticks per real second at 1x
+  double step;
+  double ticksPerSecond;
+};
+
+struct ReplayFrame {
+  // simulation time the frame showed, to check a replay against
+  double time;
+  // real seconds the frame took, fed to the simulation clock
+  float delta;
+  // camera
+  float position[3];
+  float yaw, pitch, zoom;
+  int32_t speedModifier;
+  int32_t cameraTarget;
+  uint32_t toggles;
+};
+
+// Appends frames to a log. Records are encoded into memory and written out a
+// block at a time, so recording costs a few dozen nanoseconds a frame.
+class ReplayRecorder {
+public:
+  ReplayRecorder() : file(NULL), frames(0), bytes(0) {}
+  ~ReplayRecorder() { close(); }
+
+  // creates path and writes the header, false if it cannot be created
+  bool open(const std::string &path, const ReplayHeader &header);
+  void close();
+  bool isOpen() const { return file != NULL; }
+
+  void record(const ReplayFrame &frame);
+
+  // frames and bytes recorded so far
+  size_t frameCount() const { return frames; }
+  size_t size() const { return bytes + buffer.size(); }
+
+private:
+  ReplayRecorder(const ReplayRecorder &);
+  ReplayRecorder &operator=(const ReplayRecorder &);
+
+  void flush();
+
+  FILE *file;
+  std::vector<uint8_t> buffer;
+  ReplayFrame previous;
+  size_t frames;
+  size_t bytes;
+};
+
+// Reads a log back a frame at a time.
+class ReplayPlayer {
+public:
+  ReplayHeader header;
+
+  ReplayPlayer() : offset(0), frames(0) {}
+
+  // reads the whole log, false with a message if it is not one
+  bool open(const std::string &path);
+
+  // decodes the next frame, false at the end of the log
+  bool next(ReplayFrame &frame);
+
+  // frames decoded so far
+  size_t frameCount() const { return frames; }
+  // fraction of the log played
+  float progress() const {
+    return data.empty() ? 1.0f : (float)offset / (float)data.size();
+  }
+
+private:
+  std::vector<uint8_t> data;
+  size_t offset;
+  ReplayFrame previous;
+  size_t frames;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+SceneGraph::Node SceneGraph::add(Node parent, glm::vec3 position,
+                                 glm::vec3 scale, float angle,
+                                 glm::vec3 axis) {
+  Node node = (Node)size();
+  this->parent.push_back(parent < node ? parent : ROOT);
+  this->position.push_back(position);
+  this->scale.push_back(scale);
+  this->axis.push_back(axis);
+  this->angle.push_back(angle);
+  worldMatrix.push_back(glm::mat4(1.0f));
+  dirty.push_back(1);
+  changed.push_back(0);
+  return node;
+}
+
+void SceneGraph::setPosition(Node node, glm::vec3 value) {
+  if (position[node] != value) {
+    position[node] = value;
+    dirty[node] = 1;
+  }
+}
+
+void SceneGraph::setScale(Node node, glm::vec3 value) {
+  if (scale[node] != value) {
+    scale[node] = value;
+    dirty[node] = 1;
+  }
+}
+
+void SceneGraph::setRotation(Node node, float value) {
+  if (angle[node] != value) {
+    angle[node] = value;
+    dirty[node] = 1;
+  }
+}
+
+void SceneGraph::update() {
+  updated = 0;
+  for (Node node = 0; node < size(); node++) {
+    Node up = parent[node];
+    changed[node] = dirty[node] || (up != ROOT && changed[up]);
+    if (!changed[node])
+      continue;
+
+    glm::mat4 local = glm::translate(glm::mat4(1.0f), position[node]);
+    if (angle[node] != 0.0f)
+      local = glm::rotate(local, angle[node], axis[node]);
+    local = glm::scale(local, scale[node]);
+
+    worldMatrix[node] = up == ROOT ? local : worldMatrix[up] * local;
+    dirty[node] = 0;
+    updated++;
+  }
+}
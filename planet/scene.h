@@ -0,0 +1,65 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Transform hierarchy of everything placed in the scene: orbits, planets,
+// moons and the Sun.
+//
+// Nodes live in flat arrays in the order they were added, and a node can only
+// be added under one that already exists, so parents always come before their
+// children and update() is one pass from front to back. Each node has a local
+// translation, a rotation about an axis and a scale, applied in the usual
+// T * R * S order. Setters only mark a node dirty; update() recomputes the
+// world matrices of dirty nodes and of everything below them and leaves the
+// rest alone, so static parts of the scene cost nothing per frame.
+class SceneGraph {
+public:
+  typedef uint32_t Node;
+  // parent of top level nodes
+  static const Node ROOT = 0xffffffffu;
+
+  // world matrices recomputed by the latest update()
+  size_t updated;
+
+  SceneGraph() : updated(0) {}
+
+  Node add(Node parent, glm::vec3 position = glm::vec3(0.0f),
+           glm::vec3 scale = glm::vec3(1.0f), float angle = 0.0f,
+           glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f));
+
+  size_t size() const { return parent.size(); }
+
+  void setPosition(Node node, glm::vec3 value);
+  void setScale(Node node, glm::vec3 value);
+  void setRotation(Node node, float angle);
+
+  const glm::vec3 &localPosition(Node node) const { return position[node]; }
+
+  // brings every world matrix up to date
+  void update();
+
+  // valid after update()
+  const glm::mat4 &world(Node node) const { return worldMatrix[node]; }
+  glm::vec3 worldPosition(Node node) const {
+    return glm::vec3(worldMatrix[node][3]);
+  }
+
+private:
+  std::vector<Node> parent;
+  std::vector<glm::vec3> position;
+  std::vector<glm::vec3> scale;
+  std::vector<glm::vec3> axis;
+  std::vector<float> angle;
+  std::vector<glm::mat4> worldMatrix;
+  // local transform changed since the last update()
+  std::vector<uint8_t> dirty;
+  // world matrix recomputed in the current update(), for the children
+  std::vector<uint8_t> changed;
+};
+
+#endif
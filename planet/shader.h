@@ -4,10 +4,30 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// Uniform traffic of every program, reset by whoever reads it. A set() that
+// skips an unchanged value, or finds its location in the table instead of
+// asking GL, saves a call
+struct UniformCounters {
+  size_t uploads; // glUniform*() issued
+  size_t skipped; // values already on the program
+  size_t lookups; // glGetUniformLocation() that went to the table instead
+};
+
+// A uniform of a known C++ type, resolved by name once and set by slot
+template <typename T> struct Uniform {
+  int slot;
+  Uniform() : slot(-1) {}
+  explicit Uniform(int slot) : slot(slot) {}
+};
 
 class Shader {
 public:
@@ -84,6 +104,7 @@ public:
       glAttachShader(ID, geometry);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
+    introspect();
     // delete the shaders as they're linked into our program now and no longer
     // necessary
     glDeleteShader(vertex);
@@ -91,60 +112,260 @@ public:
     if (geometryPath != nullptr)
       glDeleteShader(geometry);
   }
+  // A program for transform feedback, without a fragment shader: the
+  // outputs named in captured are written one after the other to the buffer
+  // bound to GL_TRANSFORM_FEEDBACK_BUFFER 0, for every vertex the geometry
+  // shader emits
+  // ------------------------------------------------------------------------
+  Shader(const char *vertexPath, const char *geometryPath,
+         const std::vector<std::string> &captured) {
+    unsigned int vertex =
+        compile(GL_VERTEX_SHADER, readSource(vertexPath), "VERTEX");
+    unsigned int geometry =
+        compile(GL_GEOMETRY_SHADER, readSource(geometryPath), "GEOMETRY");
+    ID = glCreateProgram();
+    glAttachShader(ID, vertex);
+    glAttachShader(ID, geometry);
+    std::vector<const char *> names;
+    for (size_t i = 0; i < captured.size(); i++)
+      names.push_back(captured[i].c_str());
+    glTransformFeedbackVaryings(ID, (GLsizei)names.size(), names.data(),
+                                GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+    introspect();
+    glDeleteShader(vertex);
+    glDeleteShader(geometry);
+  }
+  // programs are owned by the asset registry, see assets.h
+  Shader(const Shader &) = delete;
+  Shader &operator=(const Shader &) = delete;
   // activate the shader
   // ------------------------------------------------------------------------
-  void use() { glUseProgram(ID); }
+  void use() {
+    glUseProgram(ID);
+    inUse() = ID;
+  }
+  // uniform traffic since the counters were last cleared
+  // ------------------------------------------------------------------------
+  static UniformCounters &counters() {
+    static UniformCounters total = UniformCounters();
+    return total;
+  }
+  // typed uniform handles, resolve once and keep. Names the program does not
+  // have give a handle that sets nothing
+  // ------------------------------------------------------------------------
+  template <typename T> Uniform<T> uniform(const std::string &name) const {
+    int slot = find(name);
+    Slot &s = table->slots[slot];
+    if (s.location >= 0 && s.type != GL_NONE && !accepts(s.type, (T *)0))
+      std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << name
+                << std::endl;
+    return Uniform<T>(slot);
+  }
+  // Uploads value unless the program already has it. Like every set*() it
+  // goes to the program in use, which must be this one
+  template <typename T> void set(Uniform<T> uniform, const T &value) const {
+    if (uniform.slot < 0)
+      return;
+    Slot &s = table->slots[uniform.slot];
+    if (s.location < 0)
+      return;
+    // only trust what was uploaded while this program was surely bound
+    bool bound = inUse() == ID;
+    if (bound && s.known && memcmp(s.value, &value, sizeof(T)) == 0) {
+      counters().skipped++;
+      return;
+    }
+    upload(s.location, value);
+    counters().uploads++;
+    s.known = bound;
+    if (bound)
+      memcpy(s.value, &value, sizeof(T));
+  }
   // utility uniform functions
   // ------------------------------------------------------------------------
   void setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    set(uniform<int>(name), (int)value);
   }
   // ------------------------------------------------------------------------
   void setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    set(uniform<int>(name), value);
   }
   // ------------------------------------------------------------------------
   void setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    set(uniform<float>(name), value);
   }
   // ------------------------------------------------------------------------
   void setVec2(const std::string &name, const glm::vec2 &value) const {
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    set(uniform<glm::vec2>(name), value);
   }
   void setVec2(const std::string &name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    set(uniform<glm::vec2>(name), glm::vec2(x, y));
   }
   // ------------------------------------------------------------------------
   void setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    set(uniform<glm::vec3>(name), value);
   }
   void setVec3(const std::string &name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    set(uniform<glm::vec3>(name), glm::vec3(x, y, z));
   }
   // ------------------------------------------------------------------------
   void setVec4(const std::string &name, const glm::vec4 &value) const {
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    set(uniform<glm::vec4>(name), value);
   }
   void setVec4(const std::string &name, float x, float y, float z, float w) {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    set(uniform<glm::vec4>(name), glm::vec4(x, y, z, w));
   }
   // ------------------------------------------------------------------------
   void setMat2(const std::string &name, const glm::mat2 &mat) const {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                       &mat[0][0]);
+    set(uniform<glm::mat2>(name), mat);
   }
   // ------------------------------------------------------------------------
   void setMat3(const std::string &name, const glm::mat3 &mat) const {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                       &mat[0][0]);
+    set(uniform<glm::mat3>(name), mat);
   }
   // ------------------------------------------------------------------------
   void setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
-                       &mat[0][0]);
+    set(uniform<glm::mat4>(name), mat);
   }
 
 private:
+  // A uniform of the program and the last value uploaded to it
+  struct Slot {
+    GLint location;
+    GLenum type; // GL_NONE for names looked up that the program did not list
+    bool known;
+    unsigned char value[sizeof(glm::mat4)];
+  };
+  struct Table {
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, int> names;
+  };
+  std::unique_ptr<Table> table;
+
+  // program last bound through use()
+  static GLuint &inUse() {
+    static GLuint program = 0;
+    return program;
+  }
+
+  int add(const std::string &name, GLint location, GLenum type) const {
+    Slot s;
+    s.location = location;
+    s.type = type;
+    s.known = false;
+    table->slots.push_back(s);
+    int slot = (int)table->slots.size() - 1;
+    table->names[name] = slot;
+    return slot;
+  }
+  // lists the active uniforms once, after linking
+  void introspect() {
+    table.reset(new Table());
+    GLint count = 0, longest = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+    std::vector<GLchar> name(longest + 1);
+    for (GLint i = 0; i < count; i++) {
+      GLsizei length = 0;
+      GLint size = 0;
+      GLenum type = GL_NONE;
+      glGetActiveUniform(ID, i, (GLsizei)name.size(), &length, &size, &type,
+                         &name[0]);
+      std::string uniformName(&name[0], length);
+      int slot = add(uniformName, glGetUniformLocation(ID, &name[0]), type);
+      // arrays are listed as their first element, answer to the bare name
+      if (uniformName.size() > 3 &&
+          uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+        table->names[uniformName.substr(0, uniformName.size() - 3)] = slot;
+    }
+  }
+  int find(const std::string &name) const {
+    counters().lookups++;
+    std::unordered_map<std::string, int>::const_iterator it =
+        table->names.find(name);
+    if (it != table->names.end())
+      return it->second;
+    // not listed: an element past the first of an array, or a name the
+    // compiler dropped. Ask once and remember the answer either way
+    return add(name, glGetUniformLocation(ID, name.c_str()), GL_NONE);
+  }
+
+  static void upload(GLint location, int value) {
+    glUniform1i(location, value);
+  }
+  static void upload(GLint location, float value) {
+    glUniform1f(location, value);
+  }
+  static void upload(GLint location, const glm::vec2 &value) {
+    glUniform2fv(location, 1, &value[0]);
+  }
+  static void upload(GLint location, const glm::vec3 &value) {
+    glUniform3fv(location, 1, &value[0]);
+  }
+  static void upload(GLint location, const glm::vec4 &value) {
+    glUniform4fv(location, 1, &value[0]);
+  }
+  static void upload(GLint location, const glm::mat2 &mat) {
+    glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+  }
+  static void upload(GLint location, const glm::mat3 &mat) {
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+  }
+  static void upload(GLint location, const glm::mat4 &mat) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+  }
+
+  // GL types a C++ type can be uploaded to
+  static bool accepts(GLenum type, int *) {
+    return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D ||
+           type == GL_SAMPLER_CUBE;
+  }
+  static bool accepts(GLenum type, float *) { return type == GL_FLOAT; }
+  static bool accepts(GLenum type, glm::vec2 *) {
+    return type == GL_FLOAT_VEC2;
+  }
+  static bool accepts(GLenum type, glm::vec3 *) {
+    return type == GL_FLOAT_VEC3;
+  }
+  static bool accepts(GLenum type, glm::vec4 *) {
+    return type == GL_FLOAT_VEC4;
+  }
+  static bool accepts(GLenum type, glm::mat2 *) {
+    return type == GL_FLOAT_MAT2;
+  }
+  static bool accepts(GLenum type, glm::mat3 *) {
+    return type == GL_FLOAT_MAT3;
+  }
+  static bool accepts(GLenum type, glm::mat4 *) {
+    return type == GL_FLOAT_MAT4;
+  }
+
+  static std::string readSource(const char *path) {
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    std::stringstream stream;
+    try {
+      file.open(path);
+      stream << file.rdbuf();
+      file.close();
+    } catch (std::ifstream::failure &e) {
+      std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what()
+                << std::endl;
+    }
+    return stream.str();
+  }
+  unsigned int compile(GLenum stage, const std::string &code,
+                       const std::string &type) {
+    const char *source = code.c_str();
+    unsigned int shader = glCreateShader(stage);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    checkCompileErrors(shader, type);
+    return shader;
+  }
+
   // utility function for checking shader compilation/linking errors.
   // ------------------------------------------------------------------------
   void checkCompileErrors(GLuint shader, std::string type) {
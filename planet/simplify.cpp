@@ -0,0 +1,295 @@
+#include "simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// The sum of squared distances to a set of planes, each weighted:
+// Q(p) = p A p + 2 b p + c, A symmetric, and the total weight w
+struct Quadric {
+  double a00, a01, a02, a11, a12, a22;
+  double b0, b1, b2;
+  double c;
+  double w;
+};
+
+static void addPlane(Quadric &q, const double n[3], double d, double w) {
+  q.a00 += w * n[0] * n[0];
+  q.a01 += w * n[0] * n[1];
+  q.a02 += w * n[0] * n[2];
+  q.a11 += w * n[1] * n[1];
+  q.a12 += w * n[1] * n[2];
+  q.a22 += w * n[2] * n[2];
+  q.b0 += w * n[0] * d;
+  q.b1 += w * n[1] * d;
+  q.b2 += w * n[2] * d;
+  q.c += w * d * d;
+  q.w += w;
+}
+
+static void addQuadric(Quadric &q, const Quadric &r) {
+  q.a00 += r.a00;
+  q.a01 += r.a01;
+  q.a02 += r.a02;
+  q.a11 += r.a11;
+  q.a12 += r.a12;
+  q.a22 += r.a22;
+  q.b0 += r.b0;
+  q.b1 += r.b1;
+  q.b2 += r.b2;
+  q.c += r.c;
+  q.w += r.w;
+}
+
+// mean squared distance from p to the planes of q and of r together
+static double collapseCost(const Quadric &q, const Quadric &r,
+                           const double p[3]) {
+  Quadric s = q;
+  addQuadric(s, r);
+  double e = s.a00 * p[0] * p[0] + s.a11 * p[1] * p[1] + s.a22 * p[2] * p[2] +
+             2.0 * (s.a01 * p[0] * p[1] + s.a02 * p[0] * p[2] +
+                    s.a12 * p[1] * p[2]) +
+             2.0 * (s.b0 * p[0] + s.b1 * p[1] + s.b2 * p[2]) + s.c;
+  return s.w > 0.0 ? std::max(e, 0.0) / s.w : 0.0;
+}
+
+static void cross(const double a[3], const double b[3], double out[3]) {
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// unnormalised normal of the triangle through a, b and c
+static void triangleNormal(const double *a, const double *b, const double *c,
+                           double out[3]) {
+  double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+  double ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+  cross(ab, ac, out);
+}
+
+namespace {
+// a collapse of vertex from onto vertex to
+struct Collapse {
+  unsigned int from, to;
+  double cost;
+  bool operator<(const Collapse &o) const { return cost < o.cost; }
+};
+} // namespace
+
+// vertices of the triangles around v, but v
+static void neighbours(unsigned int v, const std::vector<unsigned int> &tris,
+                       const std::vector<unsigned int> &firstTri,
+                       const std::vector<unsigned int> &aroundTris,
+                       std::vector<unsigned int> &out) {
+  out.clear();
+  for (unsigned int k = firstTri[v]; k < firstTri[v + 1]; k++)
+    for (int j = 0; j < 3; j++) {
+      unsigned int w = tris[3 * aroundTris[k] + j];
+      if (w != v && std::find(out.begin(), out.end(), w) == out.end())
+        out.push_back(w);
+    }
+}
+
+// whether the two ends of an interior edge share no neighbours but the two
+// triangles on it, without which the collapse would fold the surface onto
+// itself
+static bool manifoldAfter(const Collapse &c,
+                          const std::vector<unsigned int> &tris,
+                          const std::vector<unsigned int> &firstTri,
+                          const std::vector<unsigned int> &aroundTris,
+                          std::vector<unsigned int> &from,
+                          std::vector<unsigned int> &to) {
+  neighbours(c.from, tris, firstTri, aroundTris, from);
+  neighbours(c.to, tris, firstTri, aroundTris, to);
+  size_t shared = 0;
+  for (size_t i = 0; i < from.size(); i++)
+    if (std::find(to.begin(), to.end(), from[i]) != to.end())
+      shared++;
+  return shared <= 2;
+}
+
+float simplifyMesh(const float *positions, const float *texCoords,
+                   size_t stride, size_t vertexCount,
+                   const unsigned int *indices, size_t indexCount,
+                   size_t targetCount, std::vector<unsigned int> &out) {
+  std::vector<double> p(3 * vertexCount);
+  std::vector<float> key(5 * vertexCount, 0.0f);
+  for (size_t i = 0; i < vertexCount; i++) {
+    const float *at = (const float *)((const char *)positions + stride * i);
+    for (int k = 0; k < 3; k++) {
+      p[3 * i + k] = at[k];
+      key[5 * i + k] = at[k];
+    }
+    if (texCoords != NULL) {
+      const float *uv = (const float *)((const char *)texCoords + stride * i);
+      key[5 * i + 3] = uv[0];
+      key[5 * i + 4] = uv[1];
+    }
+  }
+
+  // weld: every vertex to the first one sorted next to it with the same key
+  std::vector<unsigned int> order(vertexCount), weld(vertexCount);
+  for (size_t i = 0; i < vertexCount; i++)
+    order[i] = (unsigned int)i;
+  std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+    return std::lexicographical_compare(&key[5 * a], &key[5 * a + 5],
+                                        &key[5 * b], &key[5 * b + 5]);
+  });
+  for (size_t i = 0; i < vertexCount; i++) {
+    bool same = i > 0 && memcmp(&key[5 * order[i]], &key[5 * order[i - 1]],
+                                5 * sizeof(float)) == 0;
+    weld[order[i]] = same ? weld[order[i - 1]] : order[i];
+  }
+
+  std::vector<unsigned int> tris;
+  tris.reserve(indexCount);
+  for (size_t t = 0; t + 2 < indexCount; t += 3) {
+    unsigned int a = weld[indices[t]], b = weld[indices[t + 1]],
+                 c = weld[indices[t + 2]];
+    if (a != b && b != c && a != c) {
+      tris.push_back(a);
+      tris.push_back(b);
+      tris.push_back(c);
+    }
+  }
+
+  // edges not shared by exactly two triangles pin both their ends
+  std::vector<char> locked(vertexCount, 0);
+  std::vector<std::pair<unsigned int, unsigned int>> edges;
+  edges.reserve(tris.size());
+  for (size_t t = 0; t < tris.size(); t += 3)
+    for (int k = 0; k < 3; k++) {
+      unsigned int a = tris[t + k], b = tris[t + (k + 1) % 3];
+      edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+    }
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i;
+    while (j < edges.size() && edges[j] == edges[i])
+      j++;
+    if (j - i != 2)
+      locked[edges[i].first] = locked[edges[i].second] = 1;
+    i = j;
+  }
+
+  std::vector<Quadric> quadrics(vertexCount, Quadric());
+  for (size_t t = 0; t < tris.size(); t += 3) {
+    const double *a = &p[3 * tris[t]], *b = &p[3 * tris[t + 1]],
+                 *c = &p[3 * tris[t + 2]];
+    double n[3];
+    triangleNormal(a, b, c, n);
+    double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length == 0.0)
+      continue;
+    for (int k = 0; k < 3; k++)
+      n[k] /= length;
+    double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+    for (int k = 0; k < 3; k++)
+      addPlane(quadrics[tris[t + k]], n, d, 0.5 * length);
+  }
+
+  // Collapses go in passes. A pass sorts every edge by cost and collapses
+  // the cheapest ones whose neighbourhoods no earlier collapse of the pass
+  // has changed, until enough triangles are gone
+  double worst = 0.0;
+  std::vector<unsigned int> remap(vertexCount);
+  std::vector<unsigned int> firstTri(vertexCount + 1), aroundTris;
+  std::vector<char> touched(vertexCount);
+  std::vector<Collapse> collapses;
+  std::vector<unsigned int> fromRing, toRing;
+  while (tris.size() > targetCount) {
+    // triangles around every vertex
+    std::fill(firstTri.begin(), firstTri.end(), 0);
+    for (size_t i = 0; i < tris.size(); i++)
+      firstTri[tris[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+      firstTri[v + 1] += firstTri[v];
+    aroundTris.resize(tris.size());
+    std::vector<unsigned int> fill(firstTri.begin(), firstTri.end() - 1);
+    for (size_t i = 0; i < tris.size(); i++)
+      aroundTris[fill[tris[i]]++] = (unsigned int)(i / 3);
+
+    collapses.clear();
+    for (size_t t = 0; t < tris.size(); t += 3)
+      for (int k = 0; k < 3; k++) {
+        unsigned int a = tris[t + k], b = tris[t + (k + 1) % 3];
+        // each edge once, from the triangle that has it going up
+        if (a > b)
+          continue;
+        Collapse best = {0, 0, HUGE_VAL};
+        if (!locked[a]) {
+          Collapse c = {a, b,
+                        collapseCost(quadrics[a], quadrics[b], &p[3 * b])};
+          best = c;
+        }
+        if (!locked[b]) {
+          Collapse c = {b, a,
+                        collapseCost(quadrics[a], quadrics[b], &p[3 * a])};
+          if (c.cost < best.cost)
+            best = c;
+        }
+        if (best.cost < HUGE_VAL)
+          collapses.push_back(best);
+      }
+    std::sort(collapses.begin(), collapses.end());
+
+    for (size_t v = 0; v < vertexCount; v++)
+      remap[v] = (unsigned int)v;
+    std::fill(touched.begin(), touched.end(), 0);
+    // two triangles go with every collapse of a closed mesh
+    size_t goal = (tris.size() - targetCount) / 6 + 1;
+    size_t done = 0;
+    for (size_t i = 0; i < collapses.size() && done < goal; i++) {
+      const Collapse &c = collapses[i];
+      if (touched[c.from] || touched[c.to])
+        continue;
+      if (!manifoldAfter(c, tris, firstTri, aroundTris, fromRing, toRing))
+        continue;
+
+      bool flips = false;
+      for (unsigned int k = firstTri[c.from];
+           k < firstTri[c.from + 1] && !flips; k++) {
+        const unsigned int *tri = &tris[3 * aroundTris[k]];
+        if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+          continue; // goes away
+        const double *before[3], *after[3];
+        for (int j = 0; j < 3; j++) {
+          before[j] = &p[3 * tri[j]];
+          after[j] = tri[j] == c.from ? &p[3 * c.to] : before[j];
+        }
+        double n0[3], n1[3];
+        triangleNormal(before[0], before[1], before[2], n0);
+        triangleNormal(after[0], after[1], after[2], n1);
+        flips = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2] <= 0.0;
+      }
+      if (flips)
+        continue;
+
+      remap[c.from] = c.to;
+      addQuadric(quadrics[c.to], quadrics[c.from]);
+      for (unsigned int k = firstTri[c.from]; k < firstTri[c.from + 1]; k++) {
+        const unsigned int *tri = &tris[3 * aroundTris[k]];
+        touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+      }
+      worst = std::max(worst, c.cost);
+      done++;
+    }
+    if (done == 0)
+      break;
+
+    size_t kept = 0;
+    for (size_t t = 0; t < tris.size(); t += 3) {
+      unsigned int a = remap[tris[t]], b = remap[tris[t + 1]],
+                   c = remap[tris[t + 2]];
+      if (a != b && b != c && a != c) {
+        tris[kept++] = a;
+        tris[kept++] = b;
+        tris[kept++] = c;
+      }
+    }
+    tris.resize(kept);
+  }
+
+  out.swap(tris);
+  return (float)sqrt(worst);
+}
@@ -0,0 +1,33 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <cstddef>
+#include <vector>
+
+// Mesh simplification with quadric error metrics (Garland and Heckbert,
+// "Surface simplification using quadric error metrics", SIGGRAPH 1997).
+//
+// Edges are collapsed onto one of their two ends rather than a new point, so
+// the result indexes the same vertices as the input and a level of detail is
+// only another range of the element buffer. Every vertex carries the sum of
+// the planes of the triangles around it, area weighted, and the edge whose
+// collapse moves the surface least from those planes goes first. Collapses
+// that would flip a triangle over are skipped.
+//
+// Vertices at the same position with the same texture coordinates are
+// welded before anything else, models often come with a copy of every vertex
+// per triangle. Edges then used by a single triangle, the borders of the
+// mesh and its texture seams, are kept as they are.
+
+// Simplifies triangles, indexCount indices into vertexCount vertices, down to
+// about targetCount indices or as far as it can go, into out. The position
+// of vertex i is the three floats stride * i bytes after positions, its
+// texture coordinates the two after texCoords (NULL to weld by position
+// only). Returns the largest distance, in the units of the positions, that
+// a collapse moved the surface by
+float simplifyMesh(const float *positions, const float *texCoords,
+                   size_t stride, size_t vertexCount,
+                   const unsigned int *indices, size_t indexCount,
+                   size_t targetCount, std::vector<unsigned int> &out);
+
+#endif
@@ -0,0 +1,117 @@
+#include "snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const uint32_t SNAPSHOT_VERSION = 1;
+// field planes then the instance matrices, in floats per asteroid
+static const size_t FIELD_FLOATS = 5;
+static const size_t INSTANCE_FLOATS = 16;
+// belt arrays, in doubles per body
+static const size_t BELT_DOUBLES = 10;
+
+static size_t floatBytes(size_t asteroids) {
+  size_t bytes = asteroids * (FIELD_FLOATS + INSTANCE_FLOATS) * sizeof(float);
+  // the doubles after them stay aligned
+  return (bytes + 7) & ~(size_t)7;
+}
+
+bool Snapshot::open(const char *path) {
+  close();
+  if (!map.open(path)) {
+    std::cout << "ERROR::SNAPSHOT::Could not read " << path << std::endl;
+    return false;
+  }
+
+  const SnapshotHeader *h = (const SnapshotHeader *)map.data();
+  if (map.size() < sizeof(SnapshotHeader) || memcmp(h->magic, "SSNP", 4) != 0 ||
+      h->version != SNAPSHOT_VERSION ||
+      map.size() != sizeof(SnapshotHeader) + floatBytes(h->asteroids) +
+                        h->belt * BELT_DOUBLES * sizeof(double)) {
+    std::cout << "ERROR::SNAPSHOT::" << path << " is not a version "
+              << SNAPSHOT_VERSION << " snapshot" << std::endl;
+    close();
+    return false;
+  }
+
+  header = h;
+  floats = (const float *)(h + 1);
+  doubles = (const double *)((const char *)floats + floatBytes(h->asteroids));
+  return true;
+}
+
+void Snapshot::close() {
+  map.close();
+  header = NULL;
+  floats = NULL;
+  doubles = NULL;
+}
+
+void Snapshot::restoreField(AsteroidField &field) const {
+  size_t count = header->asteroids;
+  field.resize(count);
+  std::vector<float> *planes[FIELD_FLOATS] = {
+      &field.x, &field.y, &field.z, &field.scale, &field.rotation};
+  for (size_t p = 0; p < FIELD_FLOATS; p++)
+    if (count > 0)
+      memcpy(&(*planes[p])[0], floats + p * count, count * sizeof(float));
+}
+
+void Snapshot::restoreBelt(NBody &belt) const {
+  size_t count = header->belt;
+  std::vector<double> *arrays[BELT_DOUBLES] = {
+      &belt.x,  &belt.y,  &belt.z,     &belt.vx,    &belt.vy,
+      &belt.vz, &belt.gm, &belt.prevX, &belt.prevY, &belt.prevZ};
+  for (size_t a = 0; a < BELT_DOUBLES; a++) {
+    arrays[a]->resize(count);
+    if (count > 0)
+      memcpy(&(*arrays[a])[0], doubles + a * count, count * sizeof(double));
+  }
+}
+
+const float *Snapshot::instances() const {
+  return floats + FIELD_FLOATS * header->asteroids;
+}
+
+bool writeSnapshot(const char *path, const SnapshotHeader &state,
+                   const AsteroidField &field, const float *instances,
+                   const NBody &belt) {
+  FILE *out = fopen(path, "wb");
+  if (out == NULL) {
+    std::cout << "ERROR::SNAPSHOT::Could not create " << path << std::endl;
+    return false;
+  }
+
+  SnapshotHeader header = state;
+  memcpy(header.magic, "SSNP", 4);
+  header.version = SNAPSHOT_VERSION;
+  header.asteroids = (uint32_t)field.size();
+  header.belt = (uint32_t)belt.size();
+  fwrite(&header, sizeof(header), 1, out);
+
+  size_t count = field.size();
+  const std::vector<float> *planes[FIELD_FLOATS] = {
+      &field.x, &field.y, &field.z, &field.scale, &field.rotation};
+  if (count > 0) {
+    for (size_t p = 0; p < FIELD_FLOATS; p++)
+      fwrite(&(*planes[p])[0], sizeof(float), count, out);
+    fwrite(instances, sizeof(float) * INSTANCE_FLOATS, count, out);
+  }
+  const char padding[8] = {0};
+  size_t written = count * (FIELD_FLOATS + INSTANCE_FLOATS) * sizeof(float);
+  fwrite(padding, 1, floatBytes(count) - written, out);
+
+  const std::vector<double> *arrays[BELT_DOUBLES] = {
+      &belt.x,  &belt.y,  &belt.z,     &belt.vx,    &belt.vy,
+      &belt.vz, &belt.gm, &belt.prevX, &belt.prevY, &belt.prevZ};
+  if (belt.size() > 0)
+    for (size_t a = 0; a < BELT_DOUBLES; a++)
+      fwrite(&(*arrays[a])[0], sizeof(double), belt.size(), out);
+
+  if (fclose(out) != 0) {
+    std::cout << "ERROR::SNAPSHOT::Could not write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
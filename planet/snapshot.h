@@ -0,0 +1,72 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "asteroids.h"
+#include "mapped.h"
+#include "nbody.h"
+
+// The whole simulation at one instant, saved to a file and read back in place
+// through a memory map, so a session resumes where it was without generating
+// the asteroids or building their matrices again.
+//
+// The file is little endian, every array starting on an 8 byte boundary:
+//
+//   SnapshotHeader;
+//   float x[asteroids], y, z, scale, rotation;     the asteroid field
+//   float instances[asteroids][16];                 their model matrices
+//   double x[belt], y, z, vx, vy, vz, gm, prevX, prevY, prevZ;  N-body belt
+//
+// The belt is empty unless asteroid gravity was on.
+struct SnapshotHeader {
+  char magic[4]; // "SSNP"
+  uint32_t version;
+  uint32_t asteroids;
+  uint32_t belt;
+  // what the field was generated from
+  uint32_t seed;
+  // menu toggles, ReplayToggle bits
+  uint32_t toggles;
+  int32_t speedModifier;
+  int32_t cameraTarget;
+  // simulation clock and the time the belt is at
+  double time, previous;
+  double beltTime;
+  // camera
+  float position[3];
+  float yaw, pitch, zoom;
+};
+
+class Snapshot {
+public:
+  Snapshot() : header(NULL), floats(NULL), doubles(NULL) {}
+
+  // maps a snapshot, false with a message if it is missing or malformed
+  bool open(const char *path);
+  void close();
+  bool isOpen() const { return header != NULL; }
+
+  const SnapshotHeader &state() const { return *header; }
+
+  // copies the asteroid field and the belt out of the file
+  void restoreField(AsteroidField &field) const;
+  void restoreBelt(NBody &belt) const;
+  // model matrices of the asteroids, 16 floats each, read in place
+  const float *instances() const;
+
+private:
+  MappedFile map;
+  const SnapshotHeader *header;
+  const float *floats;
+  const double *doubles;
+};
+
+// Saves state with field, its instances (16 floats per asteroid) and belt,
+// which may be empty. The counts in state are filled in from them
+bool writeSnapshot(const char *path, const SnapshotHeader &state,
+                   const AsteroidField &field, const float *instances,
+                   const NBody &belt);
+
+#endif
@@ -0,0 +1,74 @@
+#include "stream.h"
+
+#include <chrono>
+
+// a region not free after this long is used anyway, nanoseconds
+static const GLuint64 FENCE_TIMEOUT = 100000000;
+
+void InstanceStream::create(size_t capacity, size_t stride) {
+  release();
+  this->capacity = capacity;
+  this->stride = stride;
+  glGenBuffers(1, &vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, REGIONS * capacity * stride, NULL,
+               GL_STREAM_DRAW);
+}
+
+void InstanceStream::release() {
+  for (int r = 0; r < REGIONS; r++) {
+    if (fences[r] != 0)
+      glDeleteSync(fences[r]);
+    fences[r] = 0;
+  }
+  if (vbo != 0)
+    glDeleteBuffers(1, &vbo);
+  vbo = 0;
+  region = 0;
+  mapped = NULL;
+}
+
+void *InstanceStream::map(size_t count) {
+  region = (region + 1) % REGIONS;
+  if (fences[region] != 0) {
+    GLenum state = glClientWaitSync(fences[region], 0, 0);
+    if (state == GL_TIMEOUT_EXPIRED) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT,
+                       FENCE_TIMEOUT);
+      stalls++;
+      stallSeconds += std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    }
+    glDeleteSync(fences[region]);
+    fences[region] = 0;
+  }
+
+  if (count == 0)
+    return NULL;
+  if (count > capacity)
+    count = capacity;
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  mapped = glMapBufferRange(GL_ARRAY_BUFFER, region * capacity * stride,
+                            count * stride,
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                                GL_MAP_UNSYNCHRONIZED_BIT);
+  return mapped;
+}
+
+size_t InstanceStream::unmap() {
+  if (mapped != NULL) {
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    mapped = NULL;
+  }
+  return region * capacity * stride;
+}
+
+void InstanceStream::fence() {
+  if (fences[region] != 0)
+    glDeleteSync(fences[region]);
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,56 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+// Per-instance data streamed to the GPU every frame without waiting on it.
+//
+// The buffer is cut into REGIONS regions used in turn. A frame maps the next
+// region unsynchronized, so the driver neither copies nor waits for draws
+// still reading the other regions, fills it, draws from it and fences it.
+// Before a region is mapped again its fence is waited on, which with three
+// regions has long passed unless the GPU is more than two frames behind.
+class InstanceStream {
+public:
+  static const int REGIONS = 3;
+
+  // times map() found the GPU still reading the region, and how long it
+  // waited in total
+  size_t stalls;
+  double stallSeconds;
+
+  InstanceStream()
+      : stalls(0), stallSeconds(0), vbo(0), capacity(0), stride(0),
+        region(0), mapped(NULL) {
+    for (int r = 0; r < REGIONS; r++)
+      fences[r] = 0;
+  }
+
+  // allocates the regions, capacity instances of stride bytes each
+  void create(size_t capacity, size_t stride);
+  void release();
+
+  GLuint buffer() const { return vbo; }
+
+  // maps the next region for count instances, at most capacity. NULL when
+  // count is 0
+  void *map(size_t count);
+  // unmaps it and returns where the instances start in buffer(), in bytes
+  size_t unmap();
+  // call once the draws reading the region are issued
+  void fence();
+
+private:
+  InstanceStream(const InstanceStream &);
+  InstanceStream &operator=(const InstanceStream &);
+
+  GLuint vbo;
+  size_t capacity, stride;
+  int region;
+  void *mapped;
+  GLsync fences[REGIONS];
+};
+
+#endif
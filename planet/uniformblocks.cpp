@@ -0,0 +1,67 @@
+#include "uniformblocks.h"
+
+#include <cstring>
+
+static GLuint blockBuffer(GLuint binding, size_t size) {
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  return buffer;
+}
+
+void UniformBlocks::create() {
+  release();
+  cameraBuffer = blockBuffer(CAMERA_BINDING, sizeof(CameraBlock));
+  lightBuffer = blockBuffer(LIGHT_BINDING, sizeof(LightBlock));
+}
+
+void UniformBlocks::release() {
+  if (cameraBuffer != 0)
+    glDeleteBuffers(1, &cameraBuffer);
+  if (lightBuffer != 0)
+    glDeleteBuffers(1, &lightBuffer);
+  cameraBuffer = lightBuffer = 0;
+  cameraKnown = lightKnown = false;
+}
+
+void UniformBlocks::attach(const Shader &shader) const {
+  GLuint camera = glGetUniformBlockIndex(shader.ID, "Camera");
+  if (camera != GL_INVALID_INDEX)
+    glUniformBlockBinding(shader.ID, camera, CAMERA_BINDING);
+  GLuint light = glGetUniformBlockIndex(shader.ID, "Light");
+  if (light != GL_INVALID_INDEX)
+    glUniformBlockBinding(shader.ID, light, LIGHT_BINDING);
+}
+
+// writes a whole block when it differs from what the buffer holds
+template <typename T>
+static bool update(GLuint buffer, const T &block, T &held, bool &known) {
+  if (known && memcmp(&held, &block, sizeof(T)) == 0)
+    return false;
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  held = block;
+  known = true;
+  return true;
+}
+
+void UniformBlocks::setCamera(const CameraBlock &block) {
+  if (update(cameraBuffer, block, camera, cameraKnown))
+    uploads++;
+  else
+    skipped++;
+}
+
+void UniformBlocks::setLight(const LightBlock &block) {
+  // the padding takes part in the comparison
+  LightBlock padded = block;
+  padded.padding[0] = padded.padding[1] = 0.0f;
+  if (update(lightBuffer, padded, light, lightKnown))
+    uploads++;
+  else
+    skipped++;
+}
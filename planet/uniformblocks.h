@@ -0,0 +1,69 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+// The std140 uniform blocks every program shares, laid out as GLSL declares
+// them: vec3s take the room of a vec4, hence the glm::vec4 members.
+//
+//   layout (std140) uniform Camera {
+//       mat4 projection; mat4 view; vec3 viewPos; };
+//   layout (std140) uniform Light {
+//       vec3 position; vec3 ambient; vec3 diffuse; vec3 specular;
+//       float linear; float quadratic; } light;
+struct CameraBlock {
+  glm::mat4 projection;
+  glm::mat4 view;
+  glm::vec4 viewPos;
+};
+
+struct LightBlock {
+  glm::vec4 position;
+  glm::vec4 ambient;
+  glm::vec4 diffuse;
+  glm::vec4 specular;
+  float linear;
+  float quadratic;
+  float padding[2];
+};
+
+// One buffer per block, each on its own binding point. A program attached
+// once reads whatever the buffers hold, so a frame's camera is one upload
+// however many programs draw with it.
+class UniformBlocks {
+public:
+  enum Binding { CAMERA_BINDING = 0, LIGHT_BINDING = 1 };
+
+  // uploads the block contents actually changed, and which were skipped
+  size_t uploads, skipped;
+
+  UniformBlocks()
+      : uploads(0), skipped(0), cameraBuffer(0), lightBuffer(0),
+        cameraKnown(false), lightKnown(false) {}
+
+  void create();
+  void release();
+
+  // points the blocks a program declares at the shared buffers, call once
+  // per program. Programs without one of the blocks are left alone
+  void attach(const Shader &shader) const;
+
+  // upload when the contents changed
+  void setCamera(const CameraBlock &block);
+  void setLight(const LightBlock &block);
+
+private:
+  UniformBlocks(const UniformBlocks &);
+  UniformBlocks &operator=(const UniformBlocks &);
+
+  GLuint cameraBuffer, lightBuffer;
+  CameraBlock camera;
+  LightBlock light;
+  bool cameraKnown, lightKnown;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "warp.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "kepler.h"
+
+void TimeWarp::start(const NBody &bodies, double gm, double t,
+                     int stepsPerOrbit) {
+  time = t;
+  steps = 0;
+  jumped = false;
+
+  double shortest = HUGE_VAL;
+  for (size_t i = 0; i < bodies.size(); i++) {
+    double r2 = bodies.x[i] * bodies.x[i] + bodies.y[i] * bodies.y[i] +
+                bodies.z[i] * bodies.z[i];
+    double v2 = bodies.vx[i] * bodies.vx[i] + bodies.vy[i] * bodies.vy[i] +
+                bodies.vz[i] * bodies.vz[i];
+    double a = 1.0 / (2.0 / sqrt(r2) - v2 / gm);
+    if (a > 0.0)
+      shortest = std::min(shortest, 2.0 * M_PI * sqrt(a * a * a / gm));
+  }
+  maxStep = shortest < HUGE_VAL ? shortest / stepsPerOrbit : 0.0;
+}
+
+void TimeWarp::advance(NBody &bodies, double previous, double target,
+                       double gm, const Attractors &attractors,
+                       ThreadPool &pool) {
+  steps = 0;
+  jumped = false;
+  if (target <= time || bodies.size() == 0) {
+    time = std::max(time, target);
+    return;
+  }
+  previous = std::max(previous, time);
+
+  double span = previous - time;
+  if (span > 0.0) {
+    int count = maxStep > 0.0 ? (int)ceil(span / maxStep) : maxSteps + 1;
+    if (count <= maxSteps) {
+      double h = span / count;
+      for (int k = 0; k < count; k++) {
+        bodies.step(h, attractors(time + h * 0.5), pool);
+        time += h;
+      }
+      steps = count;
+    } else {
+      // the planets' pull is left out for the skipped time
+      pool.parallelFor(bodies.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          double pos[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+          double vel[3] = {bodies.vx[i], bodies.vy[i], bodies.vz[i]};
+          if (!keplerDrift(pos, vel, gm, span)) {
+            for (int k = 0; k < 3; k++)
+              pos[k] += vel[k] * span;
+          }
+          bodies.x[i] = pos[0];
+          bodies.y[i] = pos[1];
+          bodies.z[i] = pos[2];
+          bodies.vx[i] = vel[0];
+          bodies.vy[i] = vel[1];
+          bodies.vz[i] = vel[2];
+        }
+      });
+      jumped = true;
+    }
+    time = previous;
+  }
+
+  double h = target - time;
+  bodies.step(h, attractors(time + h * 0.5), pool);
+  time = target;
+  steps++;
+}
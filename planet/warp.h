@@ -0,0 +1,49 @@
+#ifndef WARP_H
+#define WARP_H
+
+#include <functional>
+#include <vector>
+
+#include "nbody.h"
+#include "parallel.h"
+
+// Carries an N-body set across whatever simulation time a frame covers, for a
+// bounded cost at any warp factor.
+//
+// The clock's latest step is always integrated on its own, so the renderer can
+// still blend the last two states. The time before it is covered with as few
+// sub-steps as possible, none longer than a fraction of the shortest orbital
+// period in the set. When that takes more than maxSteps, the set is jumped
+// along its two-body orbits around the Sun instead, one Kepler solve per body
+// however much time is skipped.
+class TimeWarp {
+public:
+  // attractors at a given time, for the middle of each sub-step
+  typedef std::function<const std::vector<Attractor> &(double t)> Attractors;
+
+  // sub-steps allowed per frame before jumping
+  int maxSteps;
+  // longest sub-step, in ticks
+  double maxStep;
+  // simulation time the bodies are at
+  double time;
+
+  // what the latest advance() did
+  int steps;
+  bool jumped;
+
+  TimeWarp()
+      : maxSteps(8), maxStep(0.0), time(0.0), steps(0), jumped(false) {}
+
+  // starts following bodies that are at time t now, taking stepsPerOrbit
+  // steps per revolution of the fastest of them around gm at most
+  void start(const NBody &bodies, double gm, double t,
+             int stepsPerOrbit = 128);
+
+  // brings bodies from time to target, with the last step going from
+  // previous to target
+  void advance(NBody &bodies, double previous, double target, double gm,
+               const Attractors &attractors, ThreadPool &pool);
+};
+
+#endif
@@ -0,0 +1,18 @@
+#version 330 core
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in mat4 vInstance[];
+in float vVisible[];
+
+// captured by transform feedback, the rocks in view one after the other
+out mat4 instanceMatrix;
+
+void main()
+{
+    if (vVisible[0] > 0.5) {
+        instanceMatrix = vInstance[0];
+        EmitVertex();
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,74 @@
+#version 330 core
+// an OrbitInstance
+layout (location = 0) in vec4 aOrbit;
+layout (location = 1) in vec4 aPlane;
+layout (location = 2) in vec4 aBody;
+
+out mat4 vInstance;
+out float vVisible;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+
+// ticks since the epoch of the instances
+uniform float time;
+// world units per AU
+uniform float unit;
+uniform vec3 spinAxis;
+uniform float maxTurns;
+// the view frustum in world space, planes pointing inwards
+uniform vec4 planes[6];
+// rocks farther than this from the camera are dropped, world units
+uniform float cutoff;
+// how far the rock model reaches from its centre at scale 1
+uniform float modelRadius;
+
+const float PI = 3.14159265;
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+mat4 orbitMatrix()
+{
+    float e = aOrbit.y;
+    float M = mod(aOrbit.z + aOrbit.w * time, 2.0 * PI);
+    float E = M + e * sin(M);
+    for (int k = 0; k < 3; k++)
+        E -= (E - e * sin(E) - M) / (1.0 - e * cos(E));
+
+    vec4 q = normalize(aPlane);
+    // P points at periapsis, Q is 90 degrees ahead of it in the orbit plane
+    vec3 P = rotate(q, vec3(1.0, 0.0, 0.0));
+    vec3 Q = rotate(q, vec3(0.0, 1.0, 0.0));
+    vec3 r = aOrbit.x * ((cos(E) - e) * P + sqrt(1.0 - e * e) * sin(E) * Q);
+    // ecliptic to the scene's y up frame
+    vec3 position = vec3(r.x, r.z, -r.y) * unit;
+
+    // the same rotation glm::rotate() builds
+    vec4 body = aBody / 32767.0;
+    float angle = body.y * PI + body.z * maxTurns * aOrbit.w * time;
+    float c = cos(angle), s = sin(angle);
+    vec3 a = spinAxis;
+    mat3 spin = c * mat3(1.0) + (1.0 - c) * outerProduct(a, a) +
+                s * mat3(0.0, a.z, -a.y, -a.z, 0.0, a.x, a.y, -a.x, 0.0);
+    spin *= body.x;
+    return mat4(vec4(spin[0], 0.0), vec4(spin[1], 0.0), vec4(spin[2], 0.0),
+                vec4(position, 1.0));
+}
+
+void main()
+{
+    vInstance = orbitMatrix();
+    vec3 center = vInstance[3].xyz;
+    float radius = aBody.x / 32767.0 * modelRadius;
+    bool inside = distance(center, viewPos) - radius < cutoff;
+    for (int k = 0; k < 6; k++)
+        inside = inside &&
+                 dot(planes[k].xyz, center) + planes[k].w + radius >= 0.0;
+    vVisible = inside ? 1.0 : 0.0;
+}
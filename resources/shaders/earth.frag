@@ -3,29 +3,30 @@
 
 in vec2 TexCoords;
 
-struct Light {
-    vec3 position;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    
-    float constant;
-    float linear;
-    float quadratic;
-};
-
 in vec3 FragPos;
 in vec3 Normal;
 
 out vec4 color;
 
-uniform vec3 viewPos;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 uniform sampler2D texture_diffuse;
 uniform sampler2D night;
 uniform sampler2D texture_specular;
 uniform sampler2D cloud; 
-uniform Light light;
+layout (std140) uniform Light {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float linear;
+    float quadratic;
+} light;
+// the rest of the attenuation, which differs between programs
+uniform float lightConstant;
 
 uniform float time;
 
@@ -56,7 +57,7 @@ void main() {
   vec3 cloudSpecular = light.specular * spec * vec3(texture(cloud, cloudCoords));
 
   float distance    = length(light.position - FragPos);
-  float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+  float attenuation = 1.0f / (lightConstant + light.linear * distance + light.quadratic * (distance * distance));
 
   ambient  *= attenuation;
   diffuse  *= attenuation;
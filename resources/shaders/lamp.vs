@@ -6,8 +6,11 @@ layout ( location = 2 ) in vec2 texCoords;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 
 void main() {
     gl_Position = projection * view * model * vec4( position, 1.0f );
@@ -3,27 +3,28 @@
 
 in vec2 TexCoords;
 
-struct Light {
-    vec3 position;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    
-    float constant;
-    float linear;
-    float quadratic;
-};
-
 in vec3 FragPos;
 in vec3 Normal;
 
 out vec4 color;
 
-uniform vec3 viewPos;
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
 uniform sampler2D texture_diffuse;
 uniform sampler2D texture_specular;
-uniform Light light;
+layout (std140) uniform Light {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float linear;
+    float quadratic;
+} light;
+// the rest of the attenuation, which differs between programs
+uniform float lightConstant;
 
 void main() {
     vec3 ambient = light.ambient * vec3(texture(texture_diffuse, TexCoords));
@@ -41,7 +42,7 @@ void main() {
     vec3 specular = light.specular * spec * vec3(texture( texture_specular, TexCoords));
     
     float distance    = length(light.position - FragPos);
-    float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    float attenuation = 1.0f / (lightConstant + light.linear * distance + light.quadratic * (distance * distance));
 
     ambient  *= attenuation;
     diffuse  *= attenuation;
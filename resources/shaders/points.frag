@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+uniform vec3 pointColor;
+
+void main() {
+    FragColor = vec4(pointColor, 1.0);
+    BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+// one coordinate per attribute, straight from the propagator's arrays
+layout (location = 0) in float eclipticX;
+layout (location = 1) in float eclipticY;
+layout (location = 2) in float eclipticZ;
+
+layout (std140) uniform Camera {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
+// scene units per AU
+uniform float auScale;
+
+void main() {
+    vec3 world = vec3(eclipticX, eclipticZ, -eclipticY) * auScale;
+    gl_Position = projection * view * vec4(world, 1.0);
+}